@@ -0,0 +1,88 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "chip8.h"
+ #include "aot.h"
+ #include "disasm.h"
+ #include <cstring>
+ #include <mutex>
+
+ const Chip8AotProgram* Chip8Aot::program = NULL;
+ static std::once_flag decoded;
+
+ Chip8Aot::Chip8Aot(const Chip8AotProgram& p) : translation(p) {
+     enabled = false;
+     //op[] is shared by every instance, which may be built on different threads
+     std::call_once(decoded, [&p] {
+         for(int i = 0; i < p.opCount; ++i) {
+             p.ops[i] = Chip8Core::decode(p.opcodes[i], p.quirks);
+         }
+     });
+     memset(entries, 0, sizeof(entries));
+     memset(covered, 0, sizeof(covered));
+
+     //Block code sits at consecutive addresses, so the ROM image says what is in it
+     for(int b = 0; b < p.blockCount; ++b) {
+         const Chip8AotBlock& block = p.blocks[b];
+         Entry& entry = entries[block.address & 0xFFF];
+         entry.block = &block;
+         for(int i = 0; i < block.length; ++i) {
+             uint16_t at = block.address + 2 * i;
+             uint16_t opcode = p.rom[at - 0x200] << 8 | p.rom[at - 0x200 + 1];
+             entry.draws |= opcode == 0x00E0 || (opcode & 0xF000) == 0xD000;
+             entry.sounds |= (opcode & 0xF0FF) == 0xF018;
+             STATS(++entry.classes[opcode >> 12]);
+             STATS(if(flowKind(opcode) == FLOW_SKIP) entry.skipPc = at);
+             covered[at & 0xFFF] = true;
+             covered[(at + 1) & 0xFFF] = true;
+         }
+     }
+ }
+
+ void Chip8Aot::flush(const Chip8State& s) {
+     enabled = s.quirks == translation.quirks
+               && memcmp(&s.memory[0x200], translation.rom, translation.romSize) == 0;
+ }
+
+ void Chip8Aot::invalidate(uint16_t addr) {
+     if(covered[addr & 0xFFF]) {
+         enabled = false;
+     }
+ }
+
+ bool Chip8Aot::run(Chip8& chip8, uint64_t budget) {
+     if(!enabled) {
+         return false;
+     }
+     const Entry& entry = entries[chip8.state.pc & 0xFFF];
+     if(entry.block == NULL || entry.block->length > budget || (entry.sounds && chip8.sound)) {
+         return false;
+     }
+ #ifdef CHIP8_STATS
+     //Collision counts need each Dxyn to pass through emulateCycle()
+     if(entry.draws) {
+         return false;
+     }
+ #endif
+
+     if(chip8.profiler) {
+         chip8.profiler->hitBlock(chip8.state.pc, entry.block->length);
+     }
+     chip8.state.pc = entry.block->fn(chip8.state);
+     chip8.state.cycles += entry.block->length;
+     if(entry.draws) {
+         chip8.drawFlag = true;
+     }
+ #ifdef CHIP8_STATS
+     for(int i = 0; i < 16; ++i) {
+         chip8.stats.opcodeClass[i] += entry.classes[i];
+     }
+     if(entry.skipPc != 0) {
+         ++chip8.stats.skipsTested;
+         chip8.stats.skipsTaken += chip8.state.pc == entry.skipPc + 4;
+     }
+ #endif
+     return true;
+ }
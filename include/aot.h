@@ -0,0 +1,86 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstdint>
+ #include <cstddef>
+ #include "core.h"
+ #include "stats.h"
+
+ class Chip8;
+
+ //One basic block compiled ahead of time: runs it and returns the next pc
+ typedef uint16_t (*Chip8AotBlockFn)(Chip8State& s);
+
+ struct Chip8AotBlock {
+     uint16_t address;
+     uint16_t length;            //CHIP-8 instructions in the block
+     Chip8AotBlockFn fn;
+ };
+
+ //Everything ch8aot writes out for one ROM
+ struct Chip8AotProgram {
+     const char* name;
+     const uint8_t* rom;         //Image the blocks were translated from, loaded at 0x200
+     uint16_t romSize;
+     Chip8Quirks quirks;         //Profile the blocks were built for
+     const Chip8AotBlock* blocks;
+     uint16_t blockCount;
+     Chip8Op* ops;               //Instructions the blocks hand to the core's handlers, decoded
+     const uint16_t* opcodes;    //from opcodes[] once, when the first Chip8Aot is built
+     uint16_t opCount;
+ };
+
+ /*
+  *  Runtime side of ahead-of-time translation.
+  *
+  *  ch8aot walks a ROM's control flow from 0x200 and writes each basic
+  *  block out as a C++ function. Register, timer, key and branch
+  *  instructions become plain C++ the compiler can optimize across; the
+  *  display, stack, RNG and arithmetic-with-flags instructions call the
+  *  core's own handlers, so they behave exactly as interpreted. Memory
+  *  stores, Fx0A and invalid opcodes end a block and are left to the
+  *  interpreter, as are Bnnn targets and any code the walk never reached.
+  *
+  *  Linking the generated file into a front end registers its program.
+  *  Chip8 with the AOT engine then runs a block whenever the pc sits on the
+  *  start of one and it fits in the frame's remaining budget, unless it sets
+  *  the sound timer while something listens for beeper edges. Blocks only
+  *  run while memory still holds the translated ROM under the quirk profile
+  *  it was built for; the first write to a byte any block was built from
+  *  turns them all off until the ROM is loaded again.
+  */
+ class Chip8Aot {
+    public:
+        Chip8Aot(const Chip8AotProgram& program);
+        static const Chip8AotProgram* linked() {return program;}   //NULL if no translation is linked in
+        static void link(const Chip8AotProgram* p) {program = p;}
+
+        bool run(Chip8& chip8, uint64_t budget);    //false if the PC must be interpreted
+        void invalidate(uint16_t addr);     //memory at addr was written
+        void flush(const Chip8State& s);    //Memory or profile may have changed wholesale
+
+    private:
+        struct Entry {
+            const Chip8AotBlock* block;
+            bool draws;             //Holds a 00E0 or Dxyn
+            bool sounds;            //Holds an Fx18, which the beeper needs to see
+ #ifdef CHIP8_STATS
+            uint8_t classes[16];    //Instructions per high nibble
+            uint16_t skipPc;        //Address of the closing skip, 0 if none
+ #endif
+        };
+
+        static const Chip8AotProgram* program;
+        const Chip8AotProgram& translation;
+        bool enabled;                       //Memory holds the translated ROM
+        Entry entries[0x1000];              //By block address
+        bool covered[0x1000];               //Bytes some block was built from
+ };
+
+ //Static registration for generated files: static Chip8AotLink registration(program);
+ struct Chip8AotLink {
+     Chip8AotLink(const Chip8AotProgram& p) {Chip8Aot::link(&p);}
+ };
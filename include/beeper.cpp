@@ -0,0 +1,98 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "beeper.h"
+
+ Beeper::Beeper(uint32_t toneFrequency, int16_t toneVolume) {
+     device = 0;
+     frequency = toneFrequency;
+     volume = toneVolume;
+     rate = 48000;
+     lead = 0;
+     playhead = 0;
+     offset = 0;
+     anchored = false;
+     pending = false;
+     on = false;
+     phase = 0;
+     phaseStep = 0;
+ }
+
+ bool Beeper::init(int bufferSamples) {
+     if(SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+         printf("SDL audio could not initialize! SDL_Error: %s\n", SDL_GetError());
+         return false;
+     }
+     //SDL converts to whatever the device wants; only the rate and buffer size may move
+     SDL_AudioSpec want = {};
+     SDL_AudioSpec have;
+     want.freq = rate;
+     want.format = AUDIO_S16SYS;
+     want.channels = 1;
+     want.samples = bufferSamples;
+     want.callback = callback;
+     want.userdata = this;
+     device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+     if(device == 0) {
+         printf("No audio device, running silent. SDL_Error: %s\n", SDL_GetError());
+         return false;
+     }
+     rate = have.freq;
+     lead = have.samples;
+     phaseStep = ((uint64_t)frequency << 32) / rate;
+     SDL_PauseAudioDevice(device, 0);
+     return true;
+ }
+
+ void Beeper::close() {
+     if(device != 0) {
+         SDL_CloseAudioDevice(device);
+         device = 0;
+     }
+ }
+
+ void SDLCALL Beeper::callback(void* beeper, Uint8* stream, int length) {
+     static_cast<Beeper*>(beeper)->fill((int16_t*)stream, length / sizeof(int16_t));
+ }
+
+ void Beeper::fill(int16_t* out, int count) {
+     uint64_t end = playhead + count;
+     int done = 0;
+     int64_t samplesPerFrame = rate / 60;
+     for(;;) {
+         if(!pending) {
+             if(!queue.pop(next)) {
+                 break;
+             }
+             pending = true;
+             //Tie the clocks again if the edge would land in the past or too far ahead
+             int64_t emulated = next.time * rate / (60 << 16);
+             int64_t cursor = playhead + done;
+             int64_t at = emulated + offset;
+             if(!anchored || at < cursor || at > cursor + lead + samplesPerFrame) {
+                 offset = cursor + lead - emulated;
+                 anchored = true;
+             }
+         }
+         int64_t at = next.time * rate / (60 << 16) + offset;
+         if(at >= (int64_t)end) {
+             break;
+         }
+         int upTo = at - playhead;
+         render(out + done, upTo - done);
+         done = upTo;
+         on = next.on;
+         pending = false;
+     }
+     render(out + done, count - done);
+     playhead = end;
+ }
+
+ void Beeper::render(int16_t* out, int count) {
+     for(int i = 0; i < count; ++i) {
+         out[i] = !on ? 0 : (phase & 0x80000000) ? volume : -volume;
+         phase += phaseStep;
+     }
+ }
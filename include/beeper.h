@@ -0,0 +1,57 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <SDL2/SDL.h>
+ #include <cstdint>
+ #include "chip8.h"
+
+ /*
+  *  Square-wave beeper driven by the sound timer.
+  *
+  *  The emulator thread posts on/off edges into edges(), stamped in
+  *  emulated frame time (see Chip8SoundEdge). The SDL audio callback drains
+  *  the queue and switches the tone at the sample each edge maps to, so a
+  *  tone set by an Fx18 halfway through a frame starts halfway through that
+  *  frame's audio. Neither side locks or waits on the other: a busy or
+  *  stalled emulator thread just means no new edges, and the callback keeps
+  *  playing whatever the last one said.
+  *
+  *  Emulated time is tied to the audio clock by the first edge, placed one
+  *  device buffer ahead of the playhead, which absorbs the jitter of the
+  *  emulator's frame batching. The two clocks drift apart through
+  *  fast-forward, rewind and idle waits; an edge that would land in the past
+  *  or more than a frame past that lead ties them again. With the default
+  *  128-sample buffer at 48 kHz an edge is heard within about 8 ms.
+  */
+ class Beeper {
+    public:
+        Beeper(uint32_t frequency = 440, int16_t volume = 2000);
+        bool init(int bufferSamples = 128);     //false if no audio device opened; the emulator then runs silent
+        Chip8SoundQueue& edges() {return queue;}
+        void close();
+
+    private:
+        static void SDLCALL callback(void* beeper, Uint8* stream, int length);
+        void fill(int16_t* out, int count);
+        void render(int16_t* out, int count);   //count samples at the current level
+
+        SDL_AudioDeviceID device;
+        Chip8SoundQueue queue;
+        uint32_t frequency;
+        int16_t volume;
+        int rate;                   //Samples per second
+        int lead;                   //Samples an edge is scheduled ahead of the playhead
+
+        //Audio thread only
+        uint64_t playhead;          //Samples played since the device opened
+        int64_t offset;             //Playhead sample minus emulated sample
+        bool anchored;
+        Chip8SoundEdge next;        //Popped, still in the future
+        bool pending;
+        bool on;
+        uint32_t phase;             //Square wave position, high bit = upper half
+        uint32_t phaseStep;
+ };
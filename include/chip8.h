@@ -3,6 +3,7 @@
  * 2021
  */
 
+ #pragma once
  #include <cstdint>
  #include <cstdio>
  #include <cstdlib>
@@ -13,120 +14,99 @@
  #include <vector>
  #include <random>
  #include <functional>
-
-//This macro is for an array of pointer-to-member-function
-//#define CALL_MEMBER_FN(object,ptrToMember) ((object).*(ptrToMember))
+ #include <memory>
+ #include "core.h"
+ #include "stats.h"
+ #include "profiler.h"
+ #include "trace.h"
+ #include "spscqueue.h"
+
+ class Chip8Jit;
+ class Chip8Aot;
+
+ //The beeper turning on or off. time counts emulated 60 Hz frames in 16.16 fixed
+ //point: the frame number in the high bits, how far into the frame in the low 16.
+ struct Chip8SoundEdge {
+     uint64_t time;
+     bool on;
+ };
+ typedef SpscQueue<Chip8SoundEdge, 256> Chip8SoundQueue;
 
  class Chip8 {
     public:
-        Chip8(bool memoryDump = false, bool wrapX = true, bool wrapY = true);
+        enum Engine {
+            INTERPRETER,
+            JIT,            //x86-64 block recompiler, falls back to INTERPRETER elsewhere
+            AOT             //Blocks translated by ch8aot and linked in, falls back to INTERPRETER elsewhere
+        };
+
+        Chip8(bool memoryDump = false, Chip8Quirks quirks = QUIRKS_MODERN, Engine engine = INTERPRETER);
+        ~Chip8();
         void displayStatus();
         void init();
-        void loadRom(std::string romFile);
+        bool loadRom(std::string romFile);
+        bool loadRom(const std::vector<uint8_t>& rom);  //Already in memory, no console output
         void emulateCycle();
-        bool endEmulation() {return pc >= endOfRom;}
-
-        uint8_t screenBuffer[32][64]; //bitmap 64 * 32
-        int keyboard[16];
+        void runFrame(uint32_t instructions) {runFrame(instructions, NULL, 0);}   //One 60 Hz frame: a batch of instructions, then the timers. Idle loops are skipped (see Chip8IdleLoop).
+        void runFrame(uint32_t instructions, const Chip8KeyEvent* changes, size_t count);  //Key changes at their cycles, ascending, as input arrived during the frame
+        void tickTimers() {Chip8Core::tickTimers(state);}
+        void saveState(Chip8State& snapshot) const {snapshot = state;}
+        void loadState(const Chip8State& snapshot);     //Keeps the keys held; drops decoded and compiled code
+        void setSeed(uint64_t seed);    //Cxkk sequence; init() restarts it. Defaults to the clock.
+        uint64_t seed() const {return rngSeed;}
+        Chip8Quirks quirks() const {return profile;}
+        bool endEmulation() const {return Chip8Core::endEmulation(state);}
+        uint64_t cycleCount() const {return state.cycles;}
+        uint64_t skippedCycles() const {return idleCycles;}     //Of cycleCount(), the ones idle skipping counted without running
+        void setIdleSkip(bool on) {idleSkip = on;}              //On by default; off runs every idle loop out in full
+        bool waitingForKey() const {return state.keyWait;}    //Halted in Fx0A
+        Chip8Fault fault() const {return state.fault;}        //Stopped on a bad stack or opcode; loadState() recovers
+        bool timersActive() const {return state.delayTimer > 0 || state.soundTimer > 0;}
+        const Chip8Stats& statistics() const {return stats;}   //All zero unless built with CHIP8_STATS
+        void setProfiler(Profiler* p) {profiler = p;}          //Counts every retired instruction by address, NULL to stop
+        void setTrace(TraceRing* t) {trace = t;}                //Records every instruction; native blocks are skipped while set
+        void setSound(Chip8SoundQueue* q) {sound = q;}          //Posts sound timer edges as they happen, NULL to stop
+        const uint8_t* memoryData() const {return state.memory;}
+
+        void setKeys(uint16_t keys) {state.keys = keys;}      //Bit i = key i held
+        uint16_t keys() const {return state.keys;}
+
+        //64 * 32 display, one word per row. Bit 63 is the leftmost pixel (x = 0).
+        const uint64_t* screenRows() const {return state.screen;}
+        bool pixel(int x, int y) const {return (state.screen[y] >> (63 - x)) & 1;}
+        uint64_t frameHash() const {return Chip8Core::hashRows(state.screen);}
+        uint32_t takeDirtyRows();   //Rows changed since the last call, bit i = row i
         bool drawFlag;
 
-        typedef void (Chip8::*Chip8MemFn)();    //Pointer-to-member-function typedef
-        Chip8MemFn chip8Table[16] = {
-            &Chip8::cpu00E_, &Chip8::cpu1nnn, &Chip8::cpu2nnn, &Chip8::cpu3xkk,
-            &Chip8::cpu4xkk, &Chip8::cpu5xy0, &Chip8::cpu6xkk, &Chip8::cpu7xkk,
-            &Chip8::cpuARITHMETIC, &Chip8::cpu9xy0, &Chip8::cpuAnnn, &Chip8::cpuBnnn,
-            &Chip8::cpuCxkk, &Chip8::cpuDxyn, &Chip8::cpuEx_, &Chip8::cpuFx_
-        };
-
-        Chip8MemFn chip8Arithmetic[16] = {
-            &Chip8::cpu8xy0, &Chip8::cpu8xy1, &Chip8::cpu8xy2, &Chip8::cpu8xy3,
-            &Chip8::cpu8xy4, &Chip8::cpu8xy5, &Chip8::cpu8xy6, &Chip8::cpu8xy7,
-            &Chip8::cpuNULL, &Chip8::cpuNULL, &Chip8::cpuNULL, &Chip8::cpuNULL,
-            &Chip8::cpuNULL, &Chip8::cpuNULL, &Chip8::cpu8xyE, &Chip8::cpuDEFAULT
-        };
-
-
-
     private:
-        uint8_t memory[0xFFF];
-        uint16_t opcode;
-        uint16_t pc;             //Program Counter
-        uint8_t sp;              //Stack Pointer, points to topmost level of stack
-        uint8_t V[16];           //General Purpose Registers
-        uint16_t I;              //Used to store memory addresses
-        uint16_t stack[16];
-        uint8_t delayTimer;
-        uint8_t soundTimer;
+        Chip8State state;
+        uint16_t opcode;         //Last instruction interpreted, for displayStatus()
         bool memDump;
-        bool xwrap;
-        bool ywrap;
-        uint16_t endOfRom;
-
-        void loadFont();
-
-        void fetchOpcode() {
-            opcode = memory[pc] << 8 | memory[pc + 1];
-        }
-
-        /*
-         *  From Cowgod's Chip-8 Technical Reference
-         *  http://devernay.free.fr/hacks/chip8/C8TECH10.HTM
-         *
-         *  In these listings, the following variables are used:
-         *
-         *  nnn or addr - A 12-bit value, the lowest 12 bits of the instruction
-         *  n or nibble - A 4-bit value, the lowest 4 bits of the instruction
-         *  x - A 4-bit value, the lower 4 bits of the high byte of the instruction
-         *  y - A 4-bit value, the upper 4 bits of the low byte of the instruction
-         *  kk or byte - An 8-bit value, the lowest 8 bits of the instruction
-         */
-
-        void cpuNULL() {}
-
-        void cpu00E_();
-        void cpu00E0();         //CLS
-        void cpu00EE();         //RET
-
-        void cpu1nnn();         //JP   addr
-        void cpu2nnn();         //CALL addr
-        void cpu3xkk();         //SE  Vx, byte
-        void cpu4xkk();         //SNE Vx, byte
-        void cpu5xy0();         //SE  Vx, Vy
-        void cpu6xkk();         //LD  Vx, byte
-        void cpu7xkk();         //ADD Vx, byte
-
-        void cpuARITHMETIC();
-        void cpu8xy0();         //LD   Vx, Vy
-        void cpu8xy1();         //OR   Vx, Vy
-        void cpu8xy2();         //AND  Vx, Vy
-        void cpu8xy3();         //XOR  Vx, Vy
-        void cpu8xy4();         //ADD  Vx, Vy
-        void cpu8xy5();         //SUB  Vx, Vy
-        void cpu8xy6();         //SHR  Vx {, Vy}
-        void cpu8xy7();         //SUBN Vx, Vy
-        void cpu8xyE();         //SHL  Vx {, Vy}
-
-        void cpu9xy0();         //SNE Vx, Vy
-        void cpuAnnn();         //LD  I,  addr
-        void cpuBnnn();         //JP  V0, addr
-        void cpuCxkk();         //RND Vx, byte
-        void cpuDxyn();         //DRW Vx, Vy, nibble
-
-        void cpuEx_();
-        void cpuEx9E();         //SKP  Vx
-        void cpuExA1();         //SKNP Vx
-
-        void cpuFx_();
-        void cpuFx07();         //LD  Vx,  DT
-        void cpuFx0A();         //LD  Vx,  K
-        void cpuFx15();         //LD  DT,  Vx
-        void cpuFx18();         //LD  ST,  Vx
-        void cpuFx1E();         //ADD I,   Vx
-        void cpuFx29();         //LD  F,   Vx
-        void cpuFx33();         //LD  B,   Vx
-        void cpuFx55();         //LD  [I], Vx
-        void cpuFx65();         //LD  Vx,  [I]
-
-        void cpuDEFAULT();
-
-};
+        Chip8Quirks profile;     //Quirks init() starts the machine with
+        uint64_t cycleLimit;     //End of the batch runFrame() is executing, up to the next key change
+        uint64_t rngSeed;
+        Chip8Stats stats;
+        Profiler* profiler;
+        TraceRing* trace;
+        Chip8SoundQueue* sound;
+        bool beeping;           //State of the last edge posted
+        uint64_t frames;        //runFrame() calls, the sound clock
+        uint64_t frameStart;    //Cycle count runFrame() started the frame at
+        uint64_t frameEnd;      //and the cycle count its budget runs out at
+        bool idleSkip;
+        uint64_t idleCycles;    //Counted by idle skipping since init()
+
+        //Decoded-instruction cache, indexed by the address the instruction starts at.
+        //Entries are filled on first execution and dropped when memory under them is written.
+        Chip8Op decodeCache[0x1000];
+        Chip8Op endOfRomOp;
+
+        std::unique_ptr<Chip8Jit> jit;
+        friend class Chip8Jit;
+        std::unique_ptr<Chip8Aot> aot;
+        friend class Chip8Aot;
+
+        void flushDecodeCache();
+        void invalidateCode(uint16_t addr, int length);     //Memory was written
+        void postSound(uint64_t cycle);     //Posts an edge if the beeper changed, stamped at cycle
+ };
@@ -0,0 +1,210 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "conformance.h"
+ #include <algorithm>
+ #include <atomic>
+ #include <cstring>
+ #include <fstream>
+ #include <thread>
+
+ bool GoldenSuite::load(const char* path) {
+     FILE* in = fopen(path, "r");
+     if(in == NULL) {
+         printf("Error: Failed to open %s\n", path);
+         return false;
+     }
+     std::string file = path;
+     size_t slash = file.find_last_of('/');
+     directory = slash == std::string::npos ? "" : file.substr(0, slash + 1);
+     cases.clear();
+     lines.clear();
+
+     bool ok = true;
+     bool header = false;
+     char line[512];
+     while(ok && fgets(line, sizeof(line), in) != NULL) {
+         line[strcspn(line, "\r\n")] = '\0';
+         lines.push_back(line);
+         char* text = line + strspn(line, " \t");
+         if(text[0] == '\0' || text[0] == '#') {
+             continue;
+         }
+
+         char name[128];
+         char rom[256];
+         char profile[16];
+         char hash[32];
+         unsigned version;
+         unsigned ipf;
+         unsigned keys;
+         unsigned long long seed;
+         unsigned long long frame;
+         if(!header) {
+             ok = header = sscanf(text, "chip8-goldens %u", &version) == 1 && version == 1;
+         }
+         else if(sscanf(text, "case %127s %255s %15s %u %llu", name, rom, profile, &ipf, &seed) == 5) {
+             cases.emplace_back();
+             GoldenCase& c = cases.back();
+             c.name = name;
+             c.rom = rom;
+             c.ipf = ipf;
+             c.seed = seed;
+             ok = parseQuirks(profile, c.quirks) && ipf > 0;
+         }
+         else if(sscanf(text, "keys %llu %x", &frame, &keys) == 2 && !cases.empty()) {
+             Movie& input = cases.back().input;
+             ok = input.events.empty() || frame >= input.events.back().frame;
+             input.events.push_back({frame, (uint16_t)keys, 0});      //Goldens change keys at frame starts
+         }
+         else if(sscanf(text, "check %llu %31s", &frame, hash) == 2 && !cases.empty()) {
+             std::vector<GoldenCheck>& checks = cases.back().checks;
+             GoldenCheck check = {frame, 0, strcmp(hash, "-") != 0, lines.size() - 1};
+             if(check.known) {
+                 check.hash = strtoull(hash, NULL, 16);
+             }
+             ok = checks.empty() || frame > checks.back().frame;
+             checks.push_back(check);
+         }
+         else {
+             ok = false;
+         }
+     }
+     fclose(in);
+     if(!ok || !header) {
+         printf("Error: %s is not a valid goldens file (line %zu)\n", path, lines.size());
+         return false;
+     }
+     return true;
+ }
+
+ bool GoldenSuite::save(const char* path) const {
+     std::vector<std::string> out = lines;
+     char line[64];
+     for(const GoldenCase& c : cases) {
+         for(const GoldenCheck& check : c.checks) {
+             if(check.known) {
+                 snprintf(line, sizeof(line), "check %llu %016llx", (unsigned long long)check.frame, (unsigned long long)check.hash);
+             }
+             else {
+                 snprintf(line, sizeof(line), "check %llu -", (unsigned long long)check.frame);
+             }
+             out[check.line] = line;
+         }
+     }
+
+     FILE* file = fopen(path, "w");
+     if(file == NULL) {
+         printf("Error: Failed to write %s\n", path);
+         return false;
+     }
+     for(const std::string& text : out) {
+         fprintf(file, "%s\n", text.c_str());
+     }
+     fclose(file);
+     return true;
+ }
+
+ void GoldenSuite::update(const std::vector<GoldenResult>& results) {
+     for(size_t i = 0; i < cases.size(); ++i) {
+         for(size_t k = 0; k < results[i].hashes.size(); ++k) {
+             cases[i].checks[k].hash = results[i].hashes[k];
+             cases[i].checks[k].known = true;
+         }
+     }
+ }
+
+ //Runs one case through every check, keeping the display from the first mismatch
+ static void runCase(const GoldenCase& c, const std::string& directory, Chip8::Engine engine, GoldenResult& result) {
+     result.status = GOLDEN_LOAD_FAILED;
+     std::ifstream romStream(directory + c.rom, std::ios::binary);
+     if(!romStream.is_open()) {
+         return;
+     }
+     std::vector<uint8_t> rom(std::istreambuf_iterator<char>(romStream), {});
+     Chip8 chip8(false, c.quirks, engine);
+     chip8.setSeed(c.seed);
+     chip8.init();
+     if(!chip8.loadRom(rom)) {
+         return;
+     }
+
+     result.status = GOLDEN_PASS;
+     uint64_t frame = 0;
+     size_t cursor = 0;
+     std::vector<Chip8KeyEvent> changes;
+     for(const GoldenCheck& check : c.checks) {
+         while(frame < check.frame) {
+             c.input.changesAt(frame, cursor, changes);
+             chip8.runFrame(c.ipf, changes.data(), changes.size());
+             ++frame;
+         }
+         uint64_t hash = chip8.frameHash();
+         result.hashes.push_back(hash);
+         if(!check.known) {
+             if(result.status == GOLDEN_PASS) {
+                 result.status = GOLDEN_UNKNOWN;
+             }
+         }
+         else if(hash != check.hash && result.status != GOLDEN_FAIL) {
+             result.status = GOLDEN_FAIL;
+             result.frame = frame;
+             result.expected = check.hash;
+             result.actual = hash;
+             memcpy(result.screen, chip8.screenRows(), sizeof(result.screen));
+         }
+     }
+ }
+
+ std::vector<GoldenResult> GoldenSuite::run(Chip8::Engine engine, int workers) const {
+     if(workers <= 0) {
+         workers = std::thread::hardware_concurrency();
+     }
+     if(workers <= 0) {
+         workers = 1;
+     }
+     std::vector<GoldenResult> results(cases.size());
+     std::atomic<size_t> next{0};
+     auto worker = [&]() {
+         for(size_t i = next.fetch_add(1); i < cases.size(); i = next.fetch_add(1)) {
+             runCase(cases[i], directory, engine, results[i]);
+         }
+     };
+
+     std::vector<std::thread> threads;
+     for(int i = 1; i < workers; ++i) {
+         threads.emplace_back(worker);
+     }
+     worker();
+     for(std::thread& thread : threads) {
+         thread.join();
+     }
+     return results;
+ }
+
+ bool GoldenSuite::writePbm(const char* path, const uint64_t rows[32], int scale) {
+     FILE* out = fopen(path, "wb");
+     if(out == NULL) {
+         printf("Error: Failed to write %s\n", path);
+         return false;
+     }
+     //Binary PBM: 1 is black, so lit pixels are inverted to come out white on black
+     int width = 64 * scale;
+     fprintf(out, "P4\n%d %d\n", width, 32 * scale);
+     std::vector<uint8_t> line(width / 8);
+     for(int y = 0; y < 32; ++y) {
+         std::fill(line.begin(), line.end(), 0);
+         for(int x = 0; x < width; ++x) {
+             if(((rows[y] >> (63 - x / scale)) & 1) == 0) {
+                 line[x / 8] |= 0x80 >> (x % 8);
+             }
+         }
+         for(int i = 0; i < scale; ++i) {
+             fwrite(line.data(), 1, line.size(), out);
+         }
+     }
+     fclose(out);
+     return true;
+ }
@@ -0,0 +1,76 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include "chip8.h"
+ #include "movie.h"
+ #include <cstdint>
+ #include <string>
+ #include <vector>
+
+ //A frame hash the case must produce after a number of frames
+ struct GoldenCheck {
+     uint64_t frame;
+     uint64_t hash;
+     bool known;             //false until --update fills it in
+     size_t line;            //In GoldenSuite::lines
+ };
+
+ struct GoldenCase {
+     std::string name;
+     std::string rom;        //Relative to the goldens file
+     Chip8Quirks quirks = QUIRKS_MODERN;
+     uint32_t ipf = 10;
+     uint64_t seed = 0;
+     Movie input;            //Scripted keys; only events are used
+     std::vector<GoldenCheck> checks;    //Frames ascending
+ };
+
+ enum GoldenStatus {
+     GOLDEN_PASS,
+     GOLDEN_FAIL,            //Some check's hash differs
+     GOLDEN_UNKNOWN,         //Matched every hash it has, but some are missing
+     GOLDEN_LOAD_FAILED
+ };
+
+ struct GoldenResult {
+     GoldenStatus status;
+     std::vector<uint64_t> hashes;   //One per check, as run
+     uint64_t frame;                 //First failing check
+     uint64_t expected;
+     uint64_t actual;
+     uint64_t screen[32];            //Display at the first failing check
+ };
+
+ /*
+  *  Golden-frame conformance suite.
+  *
+  *  Each case runs one ROM headless under a fixed profile, seed, pacing and
+  *  scripted input, and compares frame hashes at set frames against the
+  *  ones stored in the goldens file. Cases are independent, so run() spreads
+  *  them over one worker per core. A failing case keeps the display from
+  *  its first mismatch so the front end can write it out as an image.
+  *
+  *  Goldens file format, one item per line, # starts a comment:
+  *      chip8-goldens 1
+  *      case <name> <ROM> <profile name> <ipf> <seed>
+  *      keys <frame> <key mask, hex>      (input for the case above, from that frame on)
+  *      check <frame> <hash, hex, or - if not yet known>
+  */
+ class GoldenSuite {
+    public:
+        std::vector<GoldenCase> cases;
+
+        bool load(const char* path);
+        bool save(const char* path) const;      //Comments and layout kept, hashes rewritten
+        std::vector<GoldenResult> run(Chip8::Engine engine = Chip8::INTERPRETER, int workers = 0) const;
+        void update(const std::vector<GoldenResult>& results);   //Take every hash as run as the golden
+
+        static bool writePbm(const char* path, const uint64_t rows[32], int scale = 8);
+
+    private:
+        std::string directory;      //Of the goldens file, ROM paths are relative to it
+        std::vector<std::string> lines;
+ };
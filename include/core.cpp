@@ -0,0 +1,725 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "core.h"
+ #include <algorithm>
+ #include <cstdio>
+ #include <cstdlib>
+ #include <cstring>
+
+ static const uint8_t font[80] = {
+     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+     0x20, 0x60, 0x20, 0x20, 0x70, // 1
+     0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+     0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+     0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+     0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+     0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+     0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+     0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+     0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+     0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+     0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+     0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+     0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+     0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+     0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+ };
+
+ /*
+  *  From Cowgod's Chip-8 Technical Reference
+  *  http://devernay.free.fr/hacks/chip8/C8TECH10.HTM
+  *
+  *  In these listings, the following variables are used:
+  *
+  *  nnn or addr - A 12-bit value, the lowest 12 bits of the instruction
+  *  n or nibble - A 4-bit value, the lowest 4 bits of the instruction
+  *  x - A 4-bit value, the lower 4 bits of the high byte of the instruction
+  *  y - A 4-bit value, the upper 4 bits of the low byte of the instruction
+  *  kk or byte - An 8-bit value, the lowest 8 bits of the instruction
+  */
+
+ static void cpuDEFAULT(Chip8State& s, const Chip8Op&) {
+     s.fault = FAULT_BAD_OPCODE;
+ }
+
+ static void cpu00E0(Chip8State& s, const Chip8Op&) {
+     //Clear the display
+     for (int i = 0; i < 32; ++i) {
+         if(s.screen[i] != 0) {
+             s.dirtyRows |= 1u << i;
+         }
+         s.screen[i] = 0;
+     }
+     s.pc += 2;
+ }
+
+ static void cpu00EE(Chip8State& s, const Chip8Op&) {
+     //Return from subroutine
+     if(s.sp == 0) {
+         s.fault = FAULT_STACK_UNDERFLOW;
+         return;
+     }
+     s.sp--;
+     s.pc = s.stack[s.sp];
+     s.pc += 2;
+ }
+
+ static void cpu1nnn(Chip8State& s, const Chip8Op& op) {
+     //Jump to address nnn
+     s.pc = op.nnn;
+ }
+
+ static void cpu2nnn(Chip8State& s, const Chip8Op& op) {
+     //Call subroutine at nnn
+     if(s.sp >= 16) {
+         s.fault = FAULT_STACK_OVERFLOW;
+         return;
+     }
+     s.stack[s.sp] = s.pc;
+     s.sp++;
+     s.pc = op.nnn;
+ }
+
+ static void cpu3xkk(Chip8State& s, const Chip8Op& op) {
+     //Skips next instruction if Vx == kk
+     s.pc += s.V[op.x] == op.kk ? 4 : 2;
+ }
+
+ static void cpu4xkk(Chip8State& s, const Chip8Op& op) {
+     //Skips next instruction if Vx != kk
+     s.pc += s.V[op.x] != op.kk ? 4 : 2;
+ }
+
+ static void cpu5xy0(Chip8State& s, const Chip8Op& op) {
+     //Skips next instruction if Vx == Vy
+     s.pc += s.V[op.x] == s.V[op.y] ? 4 : 2;
+ }
+
+ static void cpu6xkk(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = kk
+     s.V[op.x] = op.kk;
+     s.pc += 2;
+ }
+
+ static void cpu7xkk(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx + kk
+     s.V[op.x] += op.kk;
+     s.pc += 2;
+ }
+
+ static void cpu8xy0(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vy
+     s.V[op.x] = s.V[op.y];
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpu8xy1(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx OR Vy
+     s.V[op.x] = s.V[op.x] | s.V[op.y];
+     if(Q::vfReset) {
+         s.V[0xF] = 0;
+     }
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpu8xy2(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx AND Vy
+     s.V[op.x] = s.V[op.x] & s.V[op.y];
+     if(Q::vfReset) {
+         s.V[0xF] = 0;
+     }
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpu8xy3(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx XOR Vy
+     s.V[op.x] = s.V[op.x] ^ s.V[op.y];
+     if(Q::vfReset) {
+         s.V[0xF] = 0;
+     }
+     s.pc += 2;
+ }
+
+ static void cpu8xy4(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx + Vy, set VF = carry
+     //The flag is written last, so it wins when x is F
+     uint16_t sum = s.V[op.x] + s.V[op.y];
+     s.V[op.x] = sum;
+     s.V[0xF] = sum >> 8;
+     s.pc += 2;
+ }
+
+ static void cpu8xy5(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx - Vy, set VF = NOT borrow
+     uint8_t flag = s.V[op.x] >= s.V[op.y];
+     s.V[op.x] -= s.V[op.y];
+     s.V[0xF] = flag;
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpu8xy6(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx SHR 1 (Vy SHR 1 on the VIP)
+     uint8_t source = Q::shiftVy ? op.y : op.x;
+     uint8_t flag = s.V[source] & 1;
+     s.V[op.x] = s.V[source] >> 1;
+     s.V[0xF] = flag;
+     s.pc += 2;
+ }
+
+ static void cpu8xy7(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vy - Vx, set VF = NOT borrow
+     uint8_t flag = s.V[op.y] >= s.V[op.x];
+     s.V[op.x] = s.V[op.y] - s.V[op.x];
+     s.V[0xF] = flag;
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpu8xyE(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = Vx SHL 1 (Vy SHL 1 on the VIP)
+     uint8_t source = Q::shiftVy ? op.y : op.x;
+     uint8_t flag = s.V[source] >> 7;
+     s.V[op.x] = s.V[source] << 1;
+     s.V[0xF] = flag;
+     s.pc += 2;
+ }
+
+ static void cpu9xy0(Chip8State& s, const Chip8Op& op) {
+     //Skips next instruction if Vx != Vy
+     s.pc += s.V[op.x] != s.V[op.y] ? 4 : 2;
+ }
+
+ static void cpuAnnn(Chip8State& s, const Chip8Op& op) {
+     //Set I = nnn
+     s.I = op.nnn;
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpuBnnn(Chip8State& s, const Chip8Op& op) {
+     //Jump to location nnn + V0 (xnn + Vx on CHIP-48 and SUPER-CHIP)
+     s.pc = op.nnn + s.V[Q::jumpVx ? op.x : 0];
+ }
+
+ static void cpuCxkk(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = random byte AND kk
+     s.V[op.x] = Chip8Core::nextRandom(s.rngState) & op.kk;
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpuDxyn(Chip8State& s, const Chip8Op& op) {
+     //Display n-byte sprite starting at memory location I at (Vx, Vy)
+     //Set VF = collision
+     //The start position wraps; pixels running off an edge wrap or clip per the profile
+     uint8_t x = s.V[op.x] & 63;
+     uint8_t y = s.V[op.y] & 31;
+     uint64_t collision = 0;
+
+     for (uint8_t yOffset = 0; yOffset < op.n; ++yOffset) {
+         uint8_t row = y + yOffset;
+         if(row >= 32) {
+             if(!Q::wrapSprites) {
+                 break;
+             }
+             row &= 31;
+         }
+
+         //Line the sprite byte up with the screen word: one shift (or rotate), one AND, one XOR
+         uint64_t sprite = (uint64_t)s.memory[(s.I + yOffset) & 0xFFF] << 56;
+         uint64_t bits = sprite >> x;
+         if(Q::wrapSprites && x != 0) {
+             bits |= sprite << (64 - x);
+         }
+
+         collision |= s.screen[row] & bits;
+         s.screen[row] ^= bits;
+         s.dirtyRows |= (uint32_t)(bits != 0) << row;
+     }
+
+     s.V[0xF] = collision != 0;
+     s.pc += 2;
+ }
+
+ static void cpuEx9E(Chip8State& s, const Chip8Op& op) {
+     //Skips next instruction if key w/ value Vx is pressed
+     //Keys above F never read as pressed
+     s.pc += s.V[op.x] < 16 && ((s.keys >> s.V[op.x]) & 1) ? 4 : 2;
+ }
+
+ static void cpuExA1(Chip8State& s, const Chip8Op& op) {
+     //Skips next instruction if key w/ value Vx is NOT pressed
+     s.pc += s.V[op.x] < 16 && ((s.keys >> s.V[op.x]) & 1) ? 2 : 4;
+ }
+
+ static void cpuFx07(Chip8State& s, const Chip8Op& op) {
+     //Set Vx = delayTimer
+     s.V[op.x] = s.delayTimer;
+     s.pc += 2;
+ }
+
+ static void cpuFx0A(Chip8State& s, const Chip8Op& op) {
+     //Wait for key press, then store the value of the key in Vx
+     //The CPU halts here; step()/runFrame() resume it once a key is down
+     s.keyWait = true;
+     s.keyRegister = op.x;
+     Chip8Core::resumeOnKey(s);
+ }
+
+ static void cpuFx15(Chip8State& s, const Chip8Op& op) {
+     //Set delayTimer = Vx
+     s.delayTimer = s.V[op.x];
+     s.pc += 2;
+ }
+
+ static void cpuFx18(Chip8State& s, const Chip8Op& op) {
+     //Set soundTimer = Vx
+     s.soundTimer = s.V[op.x];
+     s.pc += 2;
+ }
+
+ static void cpuFx1E(Chip8State& s, const Chip8Op& op) {
+     //Set I = I + Vx
+     s.I += s.V[op.x];
+     s.pc += 2;
+ }
+
+ static void cpuFx29(Chip8State& s, const Chip8Op& op) {
+     //Set I = location of sprite for digit Vx, in the font at 0x050
+     s.I = 0x050 + (s.V[op.x] & 0xF) * 5;
+     s.pc += 2;
+ }
+
+ static void cpuFx33(Chip8State& s, const Chip8Op& op) {
+     //Store BCD representation of Vx in memory locations I, I+1, I+2
+     uint8_t value = s.V[op.x];
+     s.memory[s.I & 0xFFF] = value / 100;
+     s.memory[(s.I + 1) & 0xFFF] = (value / 10) % 10;
+     s.memory[(s.I + 2) & 0xFFF] = value % 10;
+     s.pc += 2;
+ }
+
+ //What Fx55/Fx65 leave in I
+ template<class Q>
+ static void advanceIndex(Chip8State& s, const Chip8Op& op) {
+     if(Q::loadStoreI == I_ADD_X) {
+         s.I += op.x;
+     }
+     else if(Q::loadStoreI == I_ADD_X_PLUS_1) {
+         s.I += op.x + 1;
+     }
+ }
+
+ template<class Q>
+ static void cpuFx55(Chip8State& s, const Chip8Op& op) {
+     //Store registers V0 through Vx in memory starting at location I.
+     for (int j = 0; j <= op.x; ++j) {
+         s.memory[(s.I + j) & 0xFFF] = s.V[j];
+     }
+     advanceIndex<Q>(s, op);
+     s.pc += 2;
+ }
+
+ template<class Q>
+ static void cpuFx65(Chip8State& s, const Chip8Op& op) {
+     //Read registers V0 through Vx from memory starting at location I.
+     for (int j = 0; j <= op.x; ++j) {
+         s.V[j] = s.memory[(s.I + j) & 0xFFF];
+     }
+     advanceIndex<Q>(s, op);
+     s.pc += 2;
+ }
+
+ /*
+  *  One instantiation per profile: its own dispatch tables, decoder and
+  *  frame loop, with the quirks folded in as constants.
+  */
+ template<class Q>
+ struct Dispatch {
+     static const Chip8Handler table[16];
+     static const Chip8Handler arithmetic[16];
+
+     static Chip8Op decode(uint16_t opcode);
+     static void step(Chip8State& s);
+     static uint64_t runFrame(Chip8State& s, uint32_t instructions, const Chip8KeyEvent* changes, size_t count, bool skipIdle);
+     static uint8_t runCached(Chip8State& s, Chip8Op cache[0x1000], uint64_t cycleLimit, uint8_t stopFlags, Chip8IdleLoop* idle, uint64_t& skipped, uint16_t& last);
+
+     //Second-level dispatch for step(), which does not keep decoded instructions
+     static void cpu0nnn(Chip8State& s, const Chip8Op& op) {
+         if(op.kk == 0xE0)
+             cpu00E0(s, op);
+         else if(op.kk == 0xEE)
+             cpu00EE(s, op);
+         else
+             cpuDEFAULT(s, op);
+     }
+
+     static void cpu8xyn(Chip8State& s, const Chip8Op& op) {
+         arithmetic[op.n](s, op);
+     }
+
+     static void cpuDecodeKk(Chip8State& s, const Chip8Op& op) {
+         //Ex and Fx leaves are picked by the whole low byte
+         Chip8Op leaf = decode(op.opcode);
+         leaf.handler(s, leaf);
+     }
+ };
+
+ //The 0x0, 0x8, 0xE and 0xF entries dispatch again on the low bits;
+ //decode() resolves those straight to the leaf handler
+ template<class Q>
+ const Chip8Handler Dispatch<Q>::table[16] = {
+     cpu0nnn, cpu1nnn, cpu2nnn, cpu3xkk,
+     cpu4xkk, cpu5xy0, cpu6xkk, cpu7xkk,
+     cpu8xyn, cpu9xy0, cpuAnnn, cpuBnnn<Q>,
+     cpuCxkk, cpuDxyn<Q>, cpuDecodeKk, cpuDecodeKk
+ };
+
+ template<class Q>
+ const Chip8Handler Dispatch<Q>::arithmetic[16] = {
+     cpu8xy0, cpu8xy1<Q>, cpu8xy2<Q>, cpu8xy3<Q>,
+     cpu8xy4, cpu8xy5, cpu8xy6<Q>, cpu8xy7,
+     cpuDEFAULT, cpuDEFAULT, cpuDEFAULT, cpuDEFAULT,
+     cpuDEFAULT, cpuDEFAULT, cpu8xyE<Q>, cpuDEFAULT
+ };
+
+ template<class Q>
+ Chip8Op Dispatch<Q>::decode(uint16_t opcode) {
+     Chip8Op d;
+     d.opcode = opcode;
+     d.nnn = opcode & 0x0FFF;
+     d.x = (opcode & 0x0F00) >> 8;
+     d.y = (opcode & 0x00F0) >> 4;
+     d.kk = opcode & 0x00FF;
+     d.n = opcode & 0x000F;
+     d.flags = 0;
+
+     switch (opcode & 0xF000) {
+         case 0x0000:
+             if(d.kk == 0xE0) {
+                 d.handler = cpu00E0;
+                 d.flags = OP_DISPLAY;
+             }
+             else if(d.kk == 0xEE)
+                 d.handler = cpu00EE;
+             else
+                 d.handler = cpuDEFAULT;
+             break;
+
+         case 0x8000:
+             d.handler = arithmetic[d.n];
+             break;
+
+         case 0xE000:
+             switch (d.kk) {
+                 case 0x9E: d.handler = cpuEx9E; d.flags = OP_SKIP; break;
+                 case 0xA1: d.handler = cpuExA1; d.flags = OP_SKIP; break;
+                 default:   d.handler = cpuDEFAULT; break;
+             }
+             break;
+
+         case 0xF000:
+             switch (d.kk) {
+                 case 0x07: d.handler = cpuFx07; break;
+                 case 0x0A: d.handler = cpuFx0A; break;
+                 case 0x15: d.handler = cpuFx15; break;
+                 case 0x18: d.handler = cpuFx18; d.flags = OP_SOUND; break;
+                 case 0x1E: d.handler = cpuFx1E; break;
+                 case 0x29: d.handler = cpuFx29; break;
+                 case 0x33: d.handler = cpuFx33; d.flags = OP_STORE; break;
+                 case 0x55: d.handler = cpuFx55<Q>; d.flags = OP_STORE; break;
+                 case 0x65: d.handler = cpuFx65<Q>; break;
+                 default:   d.handler = cpuDEFAULT; break;
+             }
+             break;
+
+         case 0x3000:
+         case 0x4000:
+         case 0x5000:
+         case 0x9000:
+             d.handler = table[opcode >> 12];
+             d.flags = OP_SKIP;
+             break;
+
+         case 0xD000:
+             d.handler = cpuDxyn<Q>;
+             d.flags = OP_DISPLAY;
+             break;
+
+         default:
+             d.handler = table[opcode >> 12];
+             break;
+     }
+     return d;
+ }
+
+ template<class Q>
+ void Dispatch<Q>::step(Chip8State& s) {
+     //Halted in Fx0A: nothing runs until a key is down
+     if(s.fault != FAULT_NONE || (s.keyWait && !Chip8Core::resumeOnKey(s))) {
+         return;
+     }
+     //Past the end of the ROM the interpreter has always cleared the screen
+     uint16_t opcode = Chip8Core::endEmulation(s) ? 0x00E0 : Chip8Core::fetch(s);
+     Chip8Op op;
+     op.opcode = opcode;
+     op.nnn = opcode & 0x0FFF;
+     op.x = (opcode & 0x0F00) >> 8;
+     op.y = (opcode & 0x00F0) >> 4;
+     op.kk = opcode & 0x00FF;
+     op.n = opcode & 0x000F;
+     table[opcode >> 12](s, op);
+     ++s.cycles;
+ }
+
+ template<class Q>
+ uint64_t Dispatch<Q>::runFrame(Chip8State& s, uint32_t instructions, const Chip8KeyEvent* changes, size_t count, bool skipIdle) {
+     uint64_t frameStart = s.cycles;
+     uint64_t frameEnd = s.cycles + instructions;
+     uint64_t skipped = 0;
+     //Batches split at key changes, as in Chip8::runFrame()
+     for(size_t next = 0; ; ++next) {
+         if(s.keyWait) {
+             Chip8Core::resumeOnKey(s);
+         }
+         uint64_t cycleLimit = next < count ? std::min(frameStart + changes[next].cycle, frameEnd) : frameEnd;
+         Chip8IdleLoop idle;
+         while(s.cycles < cycleLimit && !Chip8Core::endEmulation(s) && !s.keyWait && s.fault == FAULT_NONE) {
+             uint16_t pc = s.pc;
+             step(s);
+             if(skipIdle && s.pc <= pc) {
+                 uint64_t pass = idle.backEdge(s, pc, cycleLimit);
+                 s.cycles += pass;
+                 skipped += pass;
+             }
+         }
+         if(next == count) {
+             break;
+         }
+         s.keys = changes[next].keys;
+     }
+     Chip8Core::tickTimers(s);
+     return skipped;
+ }
+
+ template<class Q>
+ uint8_t Dispatch<Q>::runCached(Chip8State& s, Chip8Op cache[0x1000], uint64_t cycleLimit, uint8_t stopFlags, Chip8IdleLoop* idle, uint64_t& skipped, uint16_t& last) {
+     uint8_t seen = 0;
+     const Chip8Op* op = NULL;
+     //No handler reads the cycle count, so it lives in a register until an
+     //idle check or the exit needs it in the state
+     uint64_t cycles = s.cycles;
+     while(cycles < cycleLimit && !Chip8Core::endEmulation(s) && !s.keyWait && s.fault == FAULT_NONE) {
+         uint16_t pc = s.pc;
+         Chip8Op& cached = cache[pc];
+         if(cached.handler == NULL) {
+             cached = decode(Chip8Core::fetch(s));
+         }
+         op = &cached;
+         uint16_t I = s.I;
+         op->handler(s, *op);
+         ++cycles;
+         if(op->flags != 0) {
+             seen |= op->flags;
+             if(op->flags & OP_STORE) {
+                 //An instruction covering a written byte starts either there or one byte before
+                 int length = op->kk == 0x33 ? 3 : op->x + 1;
+                 for(int i = -1; i < length; ++i) {
+                     cache[(I + i) & 0xFFF].handler = NULL;
+                 }
+             }
+             if(op->flags & stopFlags) {
+                 break;
+             }
+         }
+         if(idle != NULL && s.pc <= pc) {
+             s.cycles = cycles;
+             uint64_t pass = idle->backEdge(s, pc, cycleLimit);
+             cycles += pass;
+             skipped += pass;
+         }
+     }
+     s.cycles = cycles;
+     if(op != NULL) {
+         last = op->opcode;
+     }
+     return seen;
+ }
+
+ //return Dispatch<policy for quirks>::fn(args...)
+ #define DISPATCH(quirks, fn, ...) \
+     switch(quirks) { \
+         case QUIRKS_VIP:    return Dispatch<VipQuirks>::fn(__VA_ARGS__); \
+         case QUIRKS_CHIP48: return Dispatch<Chip48Quirks>::fn(__VA_ARGS__); \
+         case QUIRKS_SCHIP:  return Dispatch<SchipQuirks>::fn(__VA_ARGS__); \
+         default:            return Dispatch<ModernQuirks>::fn(__VA_ARGS__); \
+     }
+
+ Chip8Op Chip8Core::decode(uint16_t opcode, Chip8Quirks quirks) {
+     DISPATCH(quirks, decode, opcode);
+ }
+
+ void Chip8Core::step(Chip8State& s) {
+     DISPATCH(s.quirks, step, s);
+ }
+
+ uint64_t Chip8Core::runFrame(Chip8State& s, uint32_t instructions, const Chip8KeyEvent* changes, size_t count, bool skipIdle) {
+     DISPATCH(s.quirks, runFrame, s, instructions, changes, count, skipIdle);
+ }
+
+ uint8_t Chip8Core::runCached(Chip8State& s, Chip8Op cache[0x1000], uint64_t cycleLimit, uint8_t stopFlags, Chip8IdleLoop* idle, uint64_t& skipped, uint16_t& last) {
+     DISPATCH(s.quirks, runCached, s, cache, cycleLimit, stopFlags, idle, skipped, last);
+ }
+
+ Chip8QuirkSet Chip8Core::quirkSet(Chip8Quirks quirks) {
+     switch(quirks) {
+         case QUIRKS_VIP:    return Chip8QuirkSet::of<VipQuirks>();
+         case QUIRKS_CHIP48: return Chip8QuirkSet::of<Chip48Quirks>();
+         case QUIRKS_SCHIP:  return Chip8QuirkSet::of<SchipQuirks>();
+         default:            return Chip8QuirkSet::of<ModernQuirks>();
+     }
+ }
+
+ const char* faultName(Chip8Fault fault) {
+     switch(fault) {
+         case FAULT_NONE:            return "none";
+         case FAULT_STACK_UNDERFLOW: return "stack underflow";
+         case FAULT_STACK_OVERFLOW:  return "stack overflow";
+         case FAULT_BAD_OPCODE:      return "bad opcode";
+         default:                    return "unknown";
+     }
+ }
+
+ static const char* const quirkNames[QUIRKS_COUNT] = {"modern", "vip", "chip48", "schip"};
+
+ const char* quirksName(Chip8Quirks quirks) {
+     return quirks < QUIRKS_COUNT ? quirkNames[quirks] : "unknown";
+ }
+
+ bool parseQuirks(const char* name, Chip8Quirks& quirks) {
+     for(int i = 0; i < QUIRKS_COUNT; ++i) {
+         if(strcmp(name, quirkNames[i]) == 0) {
+             quirks = (Chip8Quirks)i;
+             return true;
+         }
+     }
+     return false;
+ }
+
+ void Chip8Core::reset(Chip8State& s, uint64_t seed, Chip8Quirks quirks) {
+     memset(&s, 0, sizeof(s));
+     memcpy(&s.memory[0x050], font, sizeof(font));
+     s.pc = 0x200;       //ROM data starts at 0x200
+     s.endOfRom = 0x200;
+     s.dirtyRows = 0xFFFFFFFF;
+     s.rngState = seedRandom(seed);
+     s.quirks = quirks;
+ }
+
+ bool Chip8Core::loadRom(Chip8State& s, const uint8_t* rom, size_t size) {
+     if(size > 0x1000 - 0x200) {
+         return false;
+     }
+     memcpy(&s.memory[0x200], rom, size);
+     s.endOfRom = 0x200 + size;
+     return true;
+ }
+
+ void Chip8Core::tickTimers(Chip8State& s) {
+     if (s.delayTimer > 0) {
+         --s.delayTimer;
+     }
+     if(s.soundTimer > 0) {
+         --s.soundTimer;
+     }
+ }
+
+ bool Chip8Core::resumeOnKey(Chip8State& s) {
+     if(s.keys == 0) {
+         return false;
+     }
+     s.V[s.keyRegister] = __builtin_ctz(s.keys);    //Lowest key down, as the old 16-key scan found
+     s.keyWait = false;
+     s.pc += 2;
+     return true;
+ }
+
+ uint64_t Chip8Core::seedRandom(uint64_t seed) {
+     //splitmix64 spreads small seeds over the state; xorshift must not start at zero
+     uint64_t z = seed + 0x9E3779B97F4A7C15;
+     z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+     z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+     return (z ^ (z >> 31)) | 1;
+ }
+
+ uint64_t Chip8Core::hashRows(const uint64_t rows[32]) {
+     //FNV-style multiply/xor over whole rows
+     uint64_t hash = 0xCBF29CE484222325;
+     for(int i = 0; i < 32; ++i) {
+         hash = (hash ^ rows[i]) * 0x100000001B3;
+         hash ^= hash >> 29;
+     }
+     return hash;
+ }
+
+ uint64_t Chip8IdleLoop::backEdge(const Chip8State& s, uint16_t jump, uint64_t cycleLimit) {
+     //A fault leaves the pc where it was, which looks like a loop but is a stop
+     if(s.fault != FAULT_NONE) {
+         return 0;
+     }
+     if(s.pc != head || !unchanged(s)) {
+         record(s);
+         return 0;
+     }
+     if(jump < head) {
+         return 0;
+     }
+     //A loop that draws, stores or waits stays rejected while the instruction that
+     //made it so is still there, so only a write over it costs a rescan
+     if(jump == writerJump && writesState(s, writer)) {
+         return 0;
+     }
+     writerJump = 0xFFFF;
+     for(uint32_t addr = head; addr <= jump; ++addr) {
+         if(writesState(s, addr)) {
+             writer = addr;
+             writerJump = jump;
+             return 0;
+         }
+     }
+     uint64_t pass = s.cycles - cycles;
+     return (cycleLimit - s.cycles) / pass * pass;
+ }
+
+ void Chip8IdleLoop::record(const Chip8State& s) {
+     if(s.pc != head) {
+         writerJump = 0xFFFF;
+     }
+     head = s.pc;
+     I = s.I;
+     cycles = s.cycles;
+     rngState = s.rngState;
+     memcpy(V, s.V, sizeof(V));
+     sp = s.sp;
+     delayTimer = s.delayTimer;
+     soundTimer = s.soundTimer;
+ }
+
+ bool Chip8IdleLoop::unchanged(const Chip8State& s) const {
+     return s.I == I && s.rngState == rngState && memcmp(s.V, V, sizeof(V)) == 0
+            && s.sp == sp && s.delayTimer == delayTimer && s.soundTimer == soundTimer;
+ }
+
+ bool Chip8IdleLoop::writesState(const Chip8State& s, uint16_t addr) {
+     //Checked at every byte offset by the caller, in case a jump landed on an odd address
+     uint16_t opcode = s.memory[addr & 0xFFF] << 8 | s.memory[(addr + 1) & 0xFFF];
+     uint16_t op = opcode & 0xF0FF;
+     return (opcode & 0xF000) == 0xD000 || opcode == 0x00E0 || op == 0xF033 || op == 0xF055 || op == 0xF00A;
+ }
@@ -0,0 +1,232 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstddef>
+ #include <cstdint>
+ #include <type_traits>
+
+ //Compatibility profiles: the instruction set details CHIP-8 variants disagree on
+ enum Chip8Quirks : uint8_t {
+     QUIRKS_MODERN,      //What most current interpreters and ROMs expect; the default
+     QUIRKS_VIP,         //COSMAC VIP, the original interpreter
+     QUIRKS_CHIP48,      //CHIP-48 on the HP-48
+     QUIRKS_SCHIP,       //SUPER-CHIP 1.1
+     QUIRKS_COUNT
+ };
+
+ //What Fx55/Fx65 leave in I
+ enum Chip8IndexQuirk : uint8_t {
+     I_KEEP,             //I is unchanged
+     I_ADD_X,            //I += x
+     I_ADD_X_PLUS_1      //I += x + 1, pointing past the last register moved
+ };
+
+ /*
+  *  Quirk policies. The handlers are templates over one of these, and each
+  *  profile gets its own dispatch tables, so the hot loop never tests a
+  *  quirk: choosing a profile means choosing which instantiation runs.
+  */
+ struct ModernQuirks {
+     static const bool shiftVy = false;                      //8xy6/8xyE shift Vy into Vx rather than shifting Vx
+     static const Chip8IndexQuirk loadStoreI = I_KEEP;
+     static const bool jumpVx = false;                       //Bxnn jumps to xnn + Vx rather than nnn + V0
+     static const bool wrapSprites = true;                   //Sprites wrap at the screen edges rather than clip
+     static const bool vfReset = false;                      //8xy1/8xy2/8xy3 clear VF
+ };
+
+ struct VipQuirks {
+     static const bool shiftVy = true;
+     static const Chip8IndexQuirk loadStoreI = I_ADD_X_PLUS_1;
+     static const bool jumpVx = false;
+     static const bool wrapSprites = false;
+     static const bool vfReset = true;
+ };
+
+ struct Chip48Quirks {
+     static const bool shiftVy = false;
+     static const Chip8IndexQuirk loadStoreI = I_ADD_X;
+     static const bool jumpVx = true;
+     static const bool wrapSprites = false;
+     static const bool vfReset = false;
+ };
+
+ struct SchipQuirks {
+     static const bool shiftVy = false;
+     static const Chip8IndexQuirk loadStoreI = I_KEEP;
+     static const bool jumpVx = true;
+     static const bool wrapSprites = false;
+     static const bool vfReset = false;
+ };
+
+ //A policy as runtime values, for code generators and the lockstep engine
+ struct Chip8QuirkSet {
+     bool shiftVy;
+     Chip8IndexQuirk loadStoreI;
+     bool jumpVx;
+     bool wrapSprites;
+     bool vfReset;
+
+     template<class Q> static Chip8QuirkSet of() {
+         return {Q::shiftVy, Q::loadStoreI, Q::jumpVx, Q::wrapSprites, Q::vfReset};
+     }
+ };
+
+ //Why a machine stopped short of the end of its ROM. The pc stays on the
+ //faulting instruction, which counts as retired.
+ enum Chip8Fault : uint8_t {
+     FAULT_NONE,
+     FAULT_STACK_UNDERFLOW,      //00EE with an empty stack
+     FAULT_STACK_OVERFLOW,       //2nnn with all 16 levels in use
+     FAULT_BAD_OPCODE            //No such instruction
+ };
+
+ const char* faultName(Chip8Fault fault);
+ const char* quirksName(Chip8Quirks quirks);
+ bool parseQuirks(const char* name, Chip8Quirks& quirks);    //"modern", "vip", "chip48" or "schip"
+
+ //A whole machine as plain data: copies with one memcpy and packs densely in arrays.
+ //Doubles as the snapshot format for save states, rewind and lockstep lanes.
+ struct Chip8State {
+     uint8_t memory[0x1000];
+     uint64_t screen[32];        //One word per row, bit 63 is the leftmost pixel (x = 0)
+     uint64_t cycles;            //Instructions retired since reset
+     uint64_t rngState;          //xorshift64*, never zero
+     uint16_t stack[16];
+     uint16_t pc;
+     uint16_t I;
+     uint16_t endOfRom;
+     uint16_t keys;              //Bit i = key i held
+     uint32_t dirtyRows;         //Rows changed since the front end last looked, bit i = row i
+     uint8_t V[16];
+     uint8_t sp;
+     uint8_t delayTimer;
+     uint8_t soundTimer;
+     uint8_t keyRegister;        //Vx that receives the key Fx0A is waiting for
+     bool keyWait;               //Halted in Fx0A
+     Chip8Fault fault;           //Stopped for good until reset or a state is loaded
+     Chip8Quirks quirks;         //Profile the machine runs under
+ };
+
+ static_assert(std::is_trivially_copyable<Chip8State>::value, "Chip8State must stay plain data");
+ static_assert(sizeof(Chip8State) <= 4608, "Chip8State should stay under 4.5 KB");
+
+ //A key mask that takes over partway through a frame, for runFrame() with changes
+ struct Chip8KeyEvent {
+     uint32_t cycle;             //Instructions into the frame; at or past its budget = after the last one
+     uint16_t keys;              //Bit i = key i held
+ };
+
+ struct Chip8Op;
+ class Chip8IdleLoop;
+ typedef void (*Chip8Handler)(Chip8State& s, const Chip8Op& op);
+
+ //Chip8Op::flags, for callers that hook particular instructions
+ enum Chip8OpFlags : uint8_t {
+     OP_SKIP = 1,        //3xkk, 4xkk, 5xy0, 9xy0, Ex9E, ExA1
+     OP_DISPLAY = 2,     //00E0, Dxyn
+     OP_STORE = 4,       //Fx33, Fx55: write memory from I onwards
+     OP_SOUND = 8        //Fx18: may switch the beeper on or off
+ };
+
+ //An instruction decoded once: its leaf handler plus pre-extracted operands
+ struct Chip8Op {
+     Chip8Handler handler;       //NULL marks an empty decode cache slot
+     uint16_t opcode;
+     uint16_t nnn;
+     uint8_t x;
+     uint8_t y;
+     uint8_t kk;
+     uint8_t n;
+     uint8_t flags;              //Chip8OpFlags
+ };
+
+ /*
+  *  Stateless executor over Chip8State.
+  *
+  *  Every function works on the state it is handed, and the dispatch tables
+  *  are shared static data, so any number of machines can be stepped from
+  *  one thread with nothing per instance but the 4.4 KB state. Chip8 wraps
+  *  this with a decode cache, the JIT and the debugging hooks.
+  *
+  *  runFrame() picks the instantiation for the state's profile once and
+  *  stays in it for the whole frame.
+  */
+ class Chip8Core {
+    public:
+        static void reset(Chip8State& s, uint64_t seed, Chip8Quirks quirks = QUIRKS_MODERN);
+        static bool loadRom(Chip8State& s, const uint8_t* rom, size_t size);  //false if it does not fit
+
+        static uint16_t fetch(const Chip8State& s) {
+            return s.memory[s.pc & 0xFFF] << 8 | s.memory[(s.pc + 1) & 0xFFF];
+        }
+        static Chip8Op decode(uint16_t opcode, Chip8Quirks quirks);  //Handlers are specialized for the profile
+        static void step(Chip8State& s);                            //One instruction
+        //Same as Chip8::runFrame(). Returns the instructions idle skipping counted without running.
+        static uint64_t runFrame(Chip8State& s, uint32_t instructions, const Chip8KeyEvent* changes = NULL, size_t count = 0, bool skipIdle = true);
+        //Chip8::runFrame()'s inner loop over its decode cache. Runs until cycleLimit,
+        //the end of the ROM, a key wait or fault, or an instruction with any of
+        //stopFlags retires. Fills empty slots and empties the ones a store writes
+        //over. With an idle detector, idle passes are skipped and added to skipped.
+        //Returns the Chip8OpFlags of every instruction run, ORed; last gets the
+        //opcode of the final one.
+        static uint8_t runCached(Chip8State& s, Chip8Op cache[0x1000], uint64_t cycleLimit, uint8_t stopFlags, Chip8IdleLoop* idle, uint64_t& skipped, uint16_t& last);
+        static Chip8QuirkSet quirkSet(Chip8Quirks quirks);
+        static void tickTimers(Chip8State& s);
+        static bool resumeOnKey(Chip8State& s);     //Finishes an Fx0A if a key is down
+
+        static bool endEmulation(const Chip8State& s) {return s.pc >= s.endOfRom;}
+        static uint64_t seedRandom(uint64_t seed);  //Seed to a starting rngState
+        static uint8_t nextRandom(uint64_t& state) {   //xorshift64*, shared with the lockstep engine
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return (state * 0x2545F4914F6CDD1D) >> 56;
+        }
+        static uint64_t hashRows(const uint64_t rows[32]);
+ };
+
+ /*
+  *  Spots a frame spinning in a loop that cannot change anything until the
+  *  timers tick or the keys change, such as Fx07, 3x00, 1nnn waiting on the
+  *  delay timer or ExA1, 1nnn polling a key.
+  *
+  *  Keys and timers are fixed for the length of a batch (a frame, or the
+  *  part of one up to a key change), so once the machine comes back round to
+  *  a loop head in the state it left it, every later pass repeats the same
+  *  instructions. The rest of the batch's budget can then be counted as
+  *  retired without running it, leaving the state exactly as running it
+  *  would have. A batch needs a fresh detector.
+  *
+  *  Runners call backEdge() whenever the next pc is at or before the last
+  *  instruction they executed. Between back edges execution only moves
+  *  forward, so a pass touches nothing outside [head, jump]. The pass is idle
+  *  if nothing in that range writes memory or the display and V, I, sp, the
+  *  timers and the RNG come round unchanged. A loop that calls a subroutine
+  *  is never taken for idle, since its CALL or RET is a back edge of its own.
+  */
+ class Chip8IdleLoop {
+    public:
+        Chip8IdleLoop() : head(0xFFFF), writerJump(0xFFFF) {}
+
+        //Instructions that can be skipped: the whole passes that fit before cycleLimit
+        uint64_t backEdge(const Chip8State& s, uint16_t jump, uint64_t cycleLimit);
+
+    private:
+        uint16_t head;          //Loop head seen last, 0xFFFF for none
+        uint16_t I;
+        uint64_t cycles;
+        uint64_t rngState;
+        uint8_t V[16];
+        uint8_t sp;
+        uint8_t delayTimer;
+        uint8_t soundTimer;
+        uint16_t writer;        //Where [head, writerJump] was last found to draw, store or wait
+        uint16_t writerJump;    //0xFFFF for no such loop
+
+        void record(const Chip8State& s);
+        bool unchanged(const Chip8State& s) const;
+        static bool writesState(const Chip8State& s, uint16_t addr);     //Instruction at addr draws, stores or waits for a key
+ };
@@ -0,0 +1,82 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "disasm.h"
+ #include <cstdio>
+
+ std::string disassemble(uint16_t opcode) {
+     unsigned x = (opcode & 0x0F00) >> 8;
+     unsigned y = (opcode & 0x00F0) >> 4;
+     unsigned kk = opcode & 0x00FF;
+     unsigned nnn = opcode & 0x0FFF;
+     unsigned n = opcode & 0x000F;
+     char text[32];
+
+     switch (opcode & 0xF000) {
+         case 0x0000:
+             if(kk == 0xE0) snprintf(text, sizeof(text), "CLS");
+             else if(kk == 0xEE) snprintf(text, sizeof(text), "RET");
+             else snprintf(text, sizeof(text), "SYS  %03X", nnn);
+             break;
+         case 0x1000: snprintf(text, sizeof(text), "JP   %03X", nnn); break;
+         case 0x2000: snprintf(text, sizeof(text), "CALL %03X", nnn); break;
+         case 0x3000: snprintf(text, sizeof(text), "SE   V%X, %02X", x, kk); break;
+         case 0x4000: snprintf(text, sizeof(text), "SNE  V%X, %02X", x, kk); break;
+         case 0x5000: snprintf(text, sizeof(text), "SE   V%X, V%X", x, y); break;
+         case 0x6000: snprintf(text, sizeof(text), "LD   V%X, %02X", x, kk); break;
+         case 0x7000: snprintf(text, sizeof(text), "ADD  V%X, %02X", x, kk); break;
+         case 0x8000: {
+             static const char* names[16] = {
+                 "LD  ", "OR  ", "AND ", "XOR ", "ADD ", "SUB ", "SHR ", "SUBN",
+                 NULL, NULL, NULL, NULL, NULL, NULL, "SHL ", NULL
+             };
+             if(names[n] != NULL) snprintf(text, sizeof(text), "%s V%X, V%X", names[n], x, y);
+             else snprintf(text, sizeof(text), "???  %04X", opcode);
+             break;
+         }
+         case 0x9000: snprintf(text, sizeof(text), "SNE  V%X, V%X", x, y); break;
+         case 0xA000: snprintf(text, sizeof(text), "LD   I, %03X", nnn); break;
+         case 0xB000: snprintf(text, sizeof(text), "JP   V0, %03X", nnn); break;
+         case 0xC000: snprintf(text, sizeof(text), "RND  V%X, %02X", x, kk); break;
+         case 0xD000: snprintf(text, sizeof(text), "DRW  V%X, V%X, %X", x, y, n); break;
+         case 0xE000:
+             if(kk == 0x9E) snprintf(text, sizeof(text), "SKP  V%X", x);
+             else if(kk == 0xA1) snprintf(text, sizeof(text), "SKNP V%X", x);
+             else snprintf(text, sizeof(text), "???  %04X", opcode);
+             break;
+         default:
+             switch (kk) {
+                 case 0x07: snprintf(text, sizeof(text), "LD   V%X, DT", x); break;
+                 case 0x0A: snprintf(text, sizeof(text), "LD   V%X, K", x); break;
+                 case 0x15: snprintf(text, sizeof(text), "LD   DT, V%X", x); break;
+                 case 0x18: snprintf(text, sizeof(text), "LD   ST, V%X", x); break;
+                 case 0x1E: snprintf(text, sizeof(text), "ADD  I, V%X", x); break;
+                 case 0x29: snprintf(text, sizeof(text), "LD   F, V%X", x); break;
+                 case 0x33: snprintf(text, sizeof(text), "LD   B, V%X", x); break;
+                 case 0x55: snprintf(text, sizeof(text), "LD   [I], V%X", x); break;
+                 case 0x65: snprintf(text, sizeof(text), "LD   V%X, [I]", x); break;
+                 default:   snprintf(text, sizeof(text), "???  %04X", opcode); break;
+             }
+             break;
+     }
+     return text;
+ }
+
+ FlowKind flowKind(uint16_t opcode) {
+     switch (opcode & 0xF000) {
+         case 0x0000: return (opcode & 0x00FF) == 0xEE ? FLOW_RETURN : FLOW_NONE;
+         case 0x1000: return FLOW_JUMP;
+         case 0x2000: return FLOW_CALL;
+         case 0x3000:
+         case 0x4000:
+         case 0x5000:
+         case 0x9000: return FLOW_SKIP;
+         case 0xB000: return FLOW_COMPUTED;
+         case 0xE000:
+             return ((opcode & 0x00FF) == 0x9E || (opcode & 0x00FF) == 0xA1) ? FLOW_SKIP : FLOW_NONE;
+         case 0xF000: return (opcode & 0x00FF) == 0x0A ? FLOW_WAIT : FLOW_NONE;
+         default:     return FLOW_NONE;
+     }
+ }
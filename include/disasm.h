@@ -0,0 +1,23 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstdint>
+ #include <string>
+
+ //Cowgod-style mnemonic for one instruction, e.g. "DRW V1, V2, 5"
+ std::string disassemble(uint16_t opcode);
+
+ //Control-flow shape of an instruction, used to split code into basic blocks
+ enum FlowKind {
+     FLOW_NONE,      //Falls through to pc + 2
+     FLOW_JUMP,      //1nnn
+     FLOW_CALL,      //2nnn
+     FLOW_RETURN,    //00EE
+     FLOW_SKIP,      //3xkk, 4xkk, 5xy0, 9xy0, Ex9E, ExA1
+     FLOW_COMPUTED,  //Bnnn
+     FLOW_WAIT       //Fx0A
+ };
+ FlowKind flowKind(uint16_t opcode);
@@ -0,0 +1,314 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "fleet.h"
+ #include "lockstep.h"
+ #include "aot.h"
+ #include <atomic>
+ #include <cstdio>
+ #include <deque>
+ #include <memory>
+ #include <mutex>
+ #include <thread>
+
+ const char* fleetExitName(FleetExit reason) {
+     switch(reason) {
+         case FLEET_FRAMES:      return "frames";
+         case FLEET_END_OF_ROM:  return "end-of-rom";
+         case FLEET_HALTED:      return "halted";
+         case FLEET_FAULTED:     return "faulted";
+         default:                return "load-failed";
+     }
+ }
+
+ //One machine, or up to LANES jobs sharing a Chip8Lockstep
+ struct Session {
+     size_t job;             //First job
+     size_t count;
+     Chip8State state;       //Interpreter sessions run the bare core on this
+     bool started;
+     std::unique_ptr<Chip8> chip8;   //JIT sessions
+     std::unique_ptr<Chip8Lockstep> batch;
+     uint32_t live;          //Lanes still running
+     uint64_t frames;
+     uint64_t skipped;       //Idle-skipped instructions, interpreter sessions
+     size_t cursor;          //Into the jobs' movie
+ };
+
+ //Owner pushes and pops at the back, thieves take from the front
+ struct WorkQueue {
+     std::mutex lock;
+     std::deque<Session*> sessions;
+ };
+
+ Fleet::Fleet(int workerCount, uint32_t slice, bool useLockstep) {
+     workers = workerCount > 0 ? workerCount : std::thread::hardware_concurrency();
+     if(workers <= 0) {
+         workers = 1;
+     }
+     sliceFrames = slice > 0 ? slice : 1;
+     lockstep = useLockstep;
+     idleSkip = true;
+ }
+
+ //The part of Chip8's interface runSingle() uses, over a bare state
+ struct CoreMachine {
+     Chip8State& s;
+     uint64_t& skipped;
+     bool skipIdle;
+     bool endEmulation() const {return Chip8Core::endEmulation(s);}
+     Chip8Fault fault() const {return s.fault;}
+     bool waitingForKey() const {return s.keyWait;}
+     bool timersActive() const {return s.delayTimer > 0 || s.soundTimer > 0;}
+     void runFrame(uint32_t instructions, const Chip8KeyEvent* changes, size_t count) {
+         skipped += Chip8Core::runFrame(s, instructions, changes, count, skipIdle);
+     }
+     uint64_t frameHash() const {return Chip8Core::hashRows(s.screen);}
+     uint64_t cycleCount() const {return s.cycles;}
+     uint64_t skippedCycles() const {return skipped;}
+ };
+
+ template<class Machine>
+ static void finishSingle(Machine& chip8, const Session& session, FleetExit reason, FleetResult& result) {
+     result.reason = reason;
+     result.frameHash = chip8.frameHash();
+     result.cycles = chip8.cycleCount();
+     result.skipped = chip8.skippedCycles();
+     result.frames = session.frames;
+ }
+
+ //Runs up to sliceFrames frames. Returns false while the session has more to do.
+ template<class Machine>
+ static bool runSingle(Machine& chip8, const FleetJob& job, Session& session, uint32_t sliceFrames, FleetResult& result) {
+     std::vector<Chip8KeyEvent> changes;
+     for(uint32_t i = 0; i < sliceFrames; ++i) {
+         if(chip8.fault() != FAULT_NONE) {
+             finishSingle(chip8, session, FLEET_FAULTED, result);
+             return true;
+         }
+         if(chip8.endEmulation()) {
+             finishSingle(chip8, session, FLEET_END_OF_ROM, result);
+             return true;
+         }
+         if(job.frames != 0 && session.frames >= job.frames) {
+             finishSingle(chip8, session, FLEET_FRAMES, result);
+             return true;
+         }
+         if(job.movie != NULL) {
+             job.movie->changesAt(session.frames, session.cursor, changes);
+         }
+         chip8.runFrame(job.ipf, changes.data(), changes.size());
+         ++session.frames;
+
+         bool moreInput = job.movie != NULL && session.cursor < job.movie->events.size();
+         if(chip8.waitingForKey() && !chip8.timersActive() && !moreInput) {
+             finishSingle(chip8, session, FLEET_HALTED, result);
+             return true;
+         }
+     }
+     return false;
+ }
+
+ //Same as runSingle() for every lane of a batch; lanes leave the batch as they finish
+ static bool runBatch(const std::vector<FleetJob>& jobs, Session& session, uint32_t sliceFrames,
+                      std::vector<FleetResult>& results, std::atomic<size_t>& finished) {
+     Chip8Lockstep& batch = *session.batch;
+     const FleetJob& first = jobs[session.job];
+     auto finish = [&](int lane, FleetExit reason) {
+         FleetResult& result = results[session.job + lane];
+         result.reason = reason;
+         result.frameHash = batch.frameHash(lane);
+         result.cycles = batch.cycleCount(lane);
+         result.skipped = 0;
+         result.frames = session.frames;
+         batch.setActive(lane, false);
+         session.live &= ~(1u << lane);
+         finished.fetch_add(1, std::memory_order_release);
+     };
+
+     std::vector<Chip8KeyEvent> changes;
+     for(uint32_t i = 0; i < sliceFrames && session.live != 0; ++i) {
+         for(uint32_t rest = session.live; rest != 0; rest &= rest - 1) {
+             int lane = __builtin_ctz(rest);
+             if(batch.endEmulation(lane)) {
+                 finish(lane, FLEET_END_OF_ROM);
+             }
+             else if(first.frames != 0 && session.frames >= first.frames) {
+                 finish(lane, FLEET_FRAMES);
+             }
+         }
+         if(session.live == 0) {
+             break;
+         }
+         if(first.movie != NULL) {
+             first.movie->changesAt(session.frames, session.cursor, changes);
+         }
+         batch.runFrame(first.ipf, changes.data(), changes.size());
+         ++session.frames;
+
+         bool moreInput = first.movie != NULL && session.cursor < first.movie->events.size();
+         for(uint32_t rest = session.live; rest != 0; rest &= rest - 1) {
+             int lane = __builtin_ctz(rest);
+             if(batch.faulted(lane)) {
+                 finish(lane, FLEET_FAULTED);
+             }
+             else if(batch.waitingForKey(lane) && !batch.timersActive(lane) && !moreInput) {
+                 finish(lane, FLEET_HALTED);
+             }
+         }
+     }
+     return session.live == 0;
+ }
+
+ //Jobs that can share a lockstep batch: same ROM, pacing, profile and input
+ static bool sameBatch(const FleetJob& a, const FleetJob& b) {
+     return a.rom == b.rom && a.ipf == b.ipf && a.frames == b.frames && a.quirks == b.quirks && a.movie == b.movie;
+ }
+
+ std::vector<FleetResult> Fleet::run(const std::vector<FleetJob>& jobs, Chip8::Engine engine) {
+     std::vector<FleetResult> results(jobs.size());
+     std::vector<Session> sessions;
+     std::vector<WorkQueue> queues(workers);
+     std::atomic<size_t> finished{0};
+
+     //Compiled engines need a whole Chip8 per session
+     bool native = engine == Chip8::JIT;
+     if(engine == Chip8::AOT && !lockstep) {
+         if(Chip8Aot::linked() != NULL) {
+             native = true;
+         }
+         else {
+             printf("No ahead-of-time translation linked in, fleet sessions use the interpreter\n");
+         }
+     }
+
+     //Consecutive compatible jobs share a batch in lockstep mode
+     for(size_t i = 0; i < jobs.size(); ) {
+         size_t count = 1;
+         while(lockstep && count < (size_t)Chip8Lockstep::LANES && i + count < jobs.size()
+               && sameBatch(jobs[i], jobs[i + count])) {
+             ++count;
+         }
+         sessions.emplace_back();
+         sessions.back().job = i;
+         sessions.back().count = count;
+         sessions.back().started = false;
+         sessions.back().live = 0;
+         sessions.back().frames = 0;
+         sessions.back().skipped = 0;
+         sessions.back().cursor = 0;
+         i += count;
+     }
+
+     //Deal the sessions out round-robin; instances are only created when first run
+     for(size_t i = 0; i < sessions.size(); ++i) {
+         queues[i % workers].sessions.push_back(&sessions[i]);
+     }
+
+     auto worker = [&](int self) {
+         WorkQueue& own = queues[self];
+         while(finished.load(std::memory_order_acquire) < jobs.size()) {
+             //Newest first from our own deque keeps one instance hot in cache;
+             //thieves take the oldest, which is usually a job nobody started
+             Session* session = NULL;
+             {
+                 std::lock_guard<std::mutex> guard(own.lock);
+                 if(!own.sessions.empty()) {
+                     session = own.sessions.back();
+                     own.sessions.pop_back();
+                 }
+             }
+             for(int i = 1; session == NULL && i < workers; ++i) {
+                 WorkQueue& victim = queues[(self + i) % workers];
+                 std::lock_guard<std::mutex> guard(victim.lock);
+                 if(!victim.sessions.empty()) {
+                     session = victim.sessions.front();
+                     victim.sessions.pop_front();
+                 }
+             }
+             if(session == NULL) {
+                 //Everything left is mid-slice on another worker
+                 std::this_thread::yield();
+                 continue;
+             }
+
+             const FleetJob& job = jobs[session->job];
+             bool done;
+             if(lockstep) {
+                 if(!session->batch) {
+                     session->batch.reset(new Chip8Lockstep(job.quirks));
+                     Chip8State start;
+                     for(size_t lane = 0; lane < session->count; ++lane) {
+                         const FleetJob& laneJob = jobs[session->job + lane];
+                         Chip8Core::reset(start, laneJob.seed, laneJob.quirks);
+                         if(laneJob.rom == NULL || !Chip8Core::loadRom(start, laneJob.rom->data(), laneJob.rom->size())) {
+                             results[session->job + lane] = {FLEET_LOAD_FAILED, 0, 0, 0, 0};
+                             finished.fetch_add(1, std::memory_order_release);
+                             continue;
+                         }
+                         session->batch->load(lane, start);
+                         session->live |= 1u << lane;
+                     }
+                 }
+                 done = runBatch(jobs, *session, sliceFrames, results, finished);
+                 if(done) {
+                     session->batch.reset();
+                 }
+             }
+             else if(native) {
+                 FleetResult& result = results[session->job];
+                 if(!session->chip8) {
+                     session->chip8.reset(new Chip8(false, job.quirks, engine));
+                     session->chip8->setSeed(job.seed);
+                     session->chip8->setIdleSkip(idleSkip);
+                     session->chip8->init();
+                     if(job.rom == NULL || !session->chip8->loadRom(*job.rom)) {
+                         result = {FLEET_LOAD_FAILED, 0, 0, 0, 0};
+                         session->chip8.reset();
+                         finished.fetch_add(1, std::memory_order_release);
+                         continue;
+                     }
+                 }
+                 done = runSingle(*session->chip8, job, *session, sliceFrames, result);
+                 if(done) {
+                     session->chip8.reset();
+                     finished.fetch_add(1, std::memory_order_release);
+                 }
+             }
+             else {
+                 FleetResult& result = results[session->job];
+                 if(!session->started) {
+                     session->started = true;
+                     Chip8Core::reset(session->state, job.seed, job.quirks);
+                     if(job.rom == NULL || !Chip8Core::loadRom(session->state, job.rom->data(), job.rom->size())) {
+                         result = {FLEET_LOAD_FAILED, 0, 0, 0, 0};
+                         finished.fetch_add(1, std::memory_order_release);
+                         continue;
+                     }
+                 }
+                 CoreMachine machine = {session->state, session->skipped, idleSkip};
+                 done = runSingle(machine, job, *session, sliceFrames, result);
+                 if(done) {
+                     finished.fetch_add(1, std::memory_order_release);
+                 }
+             }
+
+             if(!done) {
+                 std::lock_guard<std::mutex> guard(own.lock);
+                 own.sessions.push_back(session);
+             }
+         }
+     };
+
+     std::vector<std::thread> threads;
+     for(int i = 1; i < workers; ++i) {
+         threads.emplace_back(worker, i);
+     }
+     worker(0);
+     for(std::thread& thread : threads) {
+         thread.join();
+     }
+     return results;
+ }
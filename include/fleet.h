@@ -0,0 +1,66 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include "chip8.h"
+ #include "movie.h"
+ #include <cstdint>
+ #include <vector>
+
+ //One headless session
+ struct FleetJob {
+     const std::vector<uint8_t>* rom;
+     uint64_t seed = 0;
+     uint32_t ipf = 10;
+     uint64_t frames = 0;            //Frame budget, 0 = until the ROM ends or halts
+     Chip8Quirks quirks = QUIRKS_MODERN;
+     const Movie* movie = NULL;      //Optional input, as in a headless replay
+ };
+
+ enum FleetExit {
+     FLEET_FRAMES,           //Ran its whole frame budget
+     FLEET_END_OF_ROM,
+     FLEET_HALTED,           //Fx0A with no timers running and no input left
+     FLEET_FAULTED,          //Bad opcode or stack over/underflow, see Chip8Fault
+     FLEET_LOAD_FAILED
+ };
+
+ struct FleetResult {
+     FleetExit reason;
+     uint64_t frameHash;
+     uint64_t cycles;
+     uint64_t skipped;               //Of cycles, the ones idle skipping counted without running
+     uint64_t frames;
+ };
+
+ const char* fleetExitName(FleetExit reason);
+
+ /*
+  *  Runs many sessions over a work-stealing pool, one worker per core.
+  *
+  *  Jobs are dealt round-robin onto per-worker deques. A worker runs its
+  *  newest session for a slice of frames and pushes it back; a worker whose
+  *  deque is empty steals the oldest session from another. Workers that
+  *  drew short sessions end up taking the remaining jobs of workers stuck
+  *  on long ones. Interpreter sessions are a bare Chip8State stepped by
+  *  Chip8Core, 4.4 KB each and stored inline; JIT and AOT sessions need a
+  *  whole Chip8, which is only created when its session first runs. AOT
+  *  with no translation linked in runs the interpreter and says so.
+  */
+ class Fleet {
+    public:
+        //0 workers = one per core. With lockstep, runs of up to Chip8Lockstep::LANES
+        //consecutive jobs on the same ROM, ipf, frame budget, quirks and movie share one batch.
+        explicit Fleet(int workers = 0, uint32_t sliceFrames = 60, bool lockstep = false);
+        void setIdleSkip(bool on) {idleSkip = on;}     //As Chip8::setIdleSkip(); the lockstep engine never skips
+        std::vector<FleetResult> run(const std::vector<FleetJob>& jobs, Chip8::Engine engine = Chip8::INTERPRETER);
+        int workerCount() const {return workers;}
+
+    private:
+        int workers;
+        uint32_t sliceFrames;
+        bool lockstep;
+        bool idleSkip;
+ };
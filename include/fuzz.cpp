@@ -0,0 +1,44 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "fuzz.h"
+
+ Chip8Fuzzer::Chip8Fuzzer(uint8_t* edgeMap, Chip8Quirks quirks, uint64_t cycles, uint32_t instructionsPerFrame) {
+     edges = edgeMap;
+     maxCycles = cycles;
+     ipf = instructionsPerFrame;
+     //The seed only feeds Cxkk, and a fixed one keeps every input reproducible
+     Chip8Core::reset(pristine, 0, quirks);
+     state = pristine;
+     found = 0;
+ }
+
+ bool Chip8Fuzzer::run(const uint8_t* data, size_t size) {
+     found = 0;
+     if(size < 2) {
+         return false;
+     }
+     state = pristine;
+     if(!Chip8Core::loadRom(state, data + 2, size - 2)) {
+         return false;
+     }
+     state.keys = data[0] | data[1] << 8;
+
+     uint64_t frameEnd = ipf;
+     while(state.cycles < maxCycles && !Chip8Core::endEmulation(state) && !state.keyWait && state.fault == FAULT_NONE) {
+         uint16_t pc = state.pc;
+         Chip8Core::step(state);
+         if(state.pc != pc + 2) {
+             uint8_t& counter = edges[((pc << 4) ^ state.pc) & (EDGES - 1)];
+             found += counter == 0;
+             counter += counter != 255;
+         }
+         if(state.cycles == frameEnd) {
+             Chip8Core::tickTimers(state);
+             frameEnd += ipf;
+         }
+     }
+     return true;
+ }
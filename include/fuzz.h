@@ -0,0 +1,43 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstddef>
+ #include <cstdint>
+ #include "core.h"
+
+ /*
+  *  Runs untrusted ROMs on the core as fast as it can reset, for fuzzing.
+  *
+  *  The machine is rebuilt for every input with one copy of a pristine
+  *  state made at construction (font loaded, everything else clear), then
+  *  the input is copied in and run for a bounded number of instructions.
+  *  Timers tick every ipf instructions, as they would in frames.
+  *
+  *  Every control transfer (any step that does not land on pc + 2) bumps
+  *  a counter in the edge bitmap, keyed on where it came from and where it
+  *  went, in the style of AFL. Counters saturate at 255.
+  *
+  *  Input layout: two bytes of held keys (bit i = key i, low byte first),
+  *  then the ROM. Nothing an input does can leave the machine: bad opcodes
+  *  and stack misuse end the run as faults.
+  */
+ class Chip8Fuzzer {
+    public:
+        static const uint32_t EDGES = 1 << 16;     //Bitmap size, in counters
+
+        Chip8Fuzzer(uint8_t* edges, Chip8Quirks quirks = QUIRKS_MODERN, uint64_t maxCycles = 1000, uint32_t ipf = 10);
+        bool run(const uint8_t* data, size_t size);     //false if the input does not fit
+        uint32_t newEdges() const {return found;}       //Counters the last run took off zero
+        const Chip8State& machine() const {return state;}
+
+    private:
+        Chip8State pristine;
+        Chip8State state;
+        uint8_t* edges;
+        uint64_t maxCycles;
+        uint32_t ipf;
+        uint32_t found;
+ };
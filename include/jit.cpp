@@ -0,0 +1,480 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "chip8.h"
+ #include "jit.h"
+ #include "disasm.h"
+ #include <cstddef>
+
+ #if defined(_WIN32) && !defined(__CYGWIN__)
+ #include <windows.h>
+ #else
+ #include <sys/mman.h>
+ #endif
+
+ #if defined(__x86_64__) || defined(_M_X64)
+ #define JIT_SUPPORTED
+ #endif
+
+ //Host registers by x86 encoding. The state pointer arrives in the first
+ //argument register; the V cache uses the caller-saved registers left over
+ //once rax (scratch), r8 (I) and r11 (memory index) are taken.
+ const uint8_t REG_AX = 0;
+ const uint8_t REG_I = 8;
+ const uint8_t REG_INDEX = 11;
+ #if defined(_WIN32) || defined(__CYGWIN__)
+ const uint8_t ARG_STATE = 1;    //rcx
+ static const uint8_t cacheRegs[] = {2, 9, 10};             //rdx, r9, r10
+ #else
+ const uint8_t ARG_STATE = 7;    //rdi
+ static const uint8_t cacheRegs[] = {6, 2, 1, 9, 10};       //rsi, rdx, rcx, r9, r10
+ #endif
+ const int CACHE_REGS = sizeof(cacheRegs);
+
+ Chip8Jit::Chip8Jit() {
+     code = NULL;
+ #ifdef JIT_SUPPORTED
+ #if defined(_WIN32) && !defined(__CYGWIN__)
+     code = (uint8_t*)VirtualAlloc(NULL, CODE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+ #else
+     void* mem = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+     code = (mem == MAP_FAILED) ? NULL : (uint8_t*)mem;
+ #endif
+ #endif
+     flush();
+ }
+
+ Chip8Jit::~Chip8Jit() {
+     if(code == NULL) {
+         return;
+     }
+ #if defined(_WIN32) && !defined(__CYGWIN__)
+     VirtualFree(code, 0, MEM_RELEASE);
+ #else
+     munmap(code, CODE_SIZE);
+ #endif
+ }
+
+ void Chip8Jit::flush() {
+     codeUsed = 0;
+     for(int i = 0; i < 0x1000; ++i) {
+         blocks[i].state = UNTRANSLATED;
+         covered[i] = false;
+     }
+ }
+
+ void Chip8Jit::invalidate(uint16_t addr) {
+     //Self-modifying code is rare enough that dropping every block is fine
+     if(covered[addr & 0xFFF]) {
+         flush();
+     }
+ }
+
+ bool Chip8Jit::run(Chip8& chip8, uint64_t cycleLimit, Chip8IdleLoop* idle) {
+     if(code == NULL) {
+         return false;
+     }
+     Chip8State& s = chip8.state;
+     bool ran = false;
+     while(s.cycles < cycleLimit) {
+         uint16_t pc = s.pc & 0xFFF;
+         Block& block = blocks[pc];
+         if(block.state == UNTRANSLATED) {
+             translate(chip8, pc);
+         }
+         if(block.state != NATIVE || block.length > cycleLimit - s.cycles || (block.sounds && chip8.sound)) {
+             break;
+         }
+
+         if(chip8.profiler) {
+             chip8.profiler->hitBlock(pc, block.length);
+         }
+         s.pc = block.fn(&s);
+         s.cycles += block.length;
+         ran = true;
+ #ifdef CHIP8_STATS
+         for(int i = 0; i < 16; ++i) {
+             chip8.stats.opcodeClass[i] += block.classes[i];
+         }
+         if(block.skipPc != 0) {
+             ++chip8.stats.skipsTested;
+             chip8.stats.skipsTaken += s.pc == block.skipPc + 4;
+         }
+ #endif
+         uint16_t last = pc + 2 * (block.length - 1);
+         //May drop this block along with any other the store hit
+         if(block.stored != 0) {
+             chip8.invalidateCode(s.I - block.storeAdvance, block.stored);
+         }
+
+         //A block is straight-line code, so its last instruction is the one that jumped
+         if(idle != NULL && s.pc <= last) {
+             uint64_t skipped = idle->backEdge(s, last, cycleLimit);
+             s.cycles += skipped;
+             chip8.idleCycles += skipped;
+             STATS(chip8.stats.idleCycles += skipped);
+         }
+     }
+     return ran;
+ }
+
+ void Chip8Jit::emit32(uint32_t v) {
+     emit8(v & 0xFF);
+     emit8((v >> 8) & 0xFF);
+     emit8((v >> 16) & 0xFF);
+     emit8((v >> 24) & 0xFF);
+ }
+
+ //REX, opcode (op2 < 0 for one byte) and ModRM with V[v] as the r/m operand:
+ //the host register caching it, or its byte in the state. The REX prefix is
+ //always there so byte registers 4-7 mean spl-dil rather than ah-bh.
+ void Chip8Jit::emitV(uint8_t op1, int op2, uint8_t reg, int v) {
+     int host = hostReg[v];
+     uint8_t base = host >= 0 ? host : ARG_STATE;
+     emit8(0x40 | (reg & 8) >> 1 | (base & 8) >> 3);
+     emit8(op1);
+     if(op2 >= 0) {
+         emit8(op2);
+     }
+     if(host >= 0) {
+         emit8(0xC0 | (reg & 7) << 3 | (host & 7));
+     }
+     else {
+         emit8(0x80 | (reg & 7) << 3 | ARG_STATE);
+         emit32(offsetof(Chip8State, V) + v);
+     }
+ }
+
+ //Same, with a field of the state at offset as the r/m operand
+ void Chip8Jit::emitState(uint8_t op1, int op2, uint8_t reg, uint32_t offset) {
+     emit8(0x40 | (reg & 8) >> 1);
+     emit8(op1);
+     if(op2 >= 0) {
+         emit8(op2);
+     }
+     emit8(0x80 | (reg & 7) << 3 | ARG_STATE);
+     emit32(offset);
+ }
+
+ //Same, with memory[r11] as the r/m operand
+ void Chip8Jit::emitMemory(uint8_t op, uint8_t reg) {
+     emit8(0x42 | (reg & 8) >> 1);                               //REX.X for r11
+     emit8(op);
+     emit8(0x84 | (reg & 7) << 3);                               //[base + index * 1 + disp32]
+     emit8((REG_INDEX & 7) << 3 | ARG_STATE);
+     emit32(offsetof(Chip8State, memory));
+ }
+
+ //r11 = (I + i) & 0xFFF, the address Fx55/Fx65 move register i through
+ void Chip8Jit::emitIndex(int i) {
+     emit8(0x45); emit8(0x0F); emit8(0xB7); emit8(0xD8);         //movzx r11d, r8w
+     if(i != 0) {
+         emit8(0x41); emit8(0x83); emit8(0xC3); emit8(i);        //add r11d, i
+     }
+     emit8(0x41); emit8(0x81); emit8(0xE3); emit32(0xFFF);       //and r11d, 0xFFF
+ }
+
+ //Writes the cached registers and I back; leaves the flags alone
+ void Chip8Jit::emitExit() {
+     for(int v = 0; v < 16; ++v) {
+         if(hostReg[v] >= 0 && ((dirty >> v) & 1)) {
+             emitState(0x88, -1, hostReg[v], offsetof(Chip8State, V) + v);   //mov [V + v], reg
+         }
+     }
+     emit8(0x66); emitState(0x89, -1, REG_I, offsetof(Chip8State, I));     //mov [I], r8w
+ }
+
+ void Chip8Jit::emitReturn(uint32_t nextPc) {
+     emitExit();
+     emit8(0xB8); emit32(nextPc);                    //mov eax, nextPc
+     emit8(0xC3);                                    //ret
+ }
+
+ void Chip8Jit::emitSkip(uint8_t jcc, uint16_t pc) {
+     //Flags are already set by a compare; mov leaves them alone
+     emitExit();
+     emit8(0xB8); emit32(pc + 2);                    //mov eax, pc + 2
+     emit8(jcc); emit8(0x05);                        //jcc over the next mov
+     emit8(0xB8); emit32(pc + 4);                    //mov eax, pc + 4
+     emit8(0xC3);                                    //ret
+ }
+
+ //Instructions a block can hold, and the ones that close it
+ static bool compilable(uint16_t opcode) {
+     switch(opcode & 0xF000) {
+         case 0x1000: case 0x3000: case 0x4000: case 0x6000:
+         case 0x7000: case 0xA000: case 0xB000:
+             return true;
+         case 0x5000: case 0x9000:
+             return (opcode & 0xF) == 0;
+         case 0x8000:
+             return (opcode & 0xF) <= 7 || (opcode & 0xF) == 0xE;
+         case 0xF000:
+             switch(opcode & 0xFF) {
+                 case 0x07: case 0x15: case 0x18: case 0x1E: case 0x55: case 0x65:
+                     return true;
+             }
+             return false;
+         default:
+             return false;
+     }
+ }
+
+ static bool terminates(uint16_t opcode) {
+     FlowKind flow = flowKind(opcode);
+     return flow == FLOW_JUMP || flow == FLOW_SKIP || flow == FLOW_COMPUTED || (opcode & 0xF0FF) == 0xF055;
+ }
+
+ //Gives host registers to the V registers the block names most, if at least twice:
+ //one use costs the same from memory and saves the load and store
+ void Chip8Jit::allocate(const uint16_t* opcodes, int length, const Chip8QuirkSet& quirks) {
+     int uses[16] = {0};
+     for(int i = 0; i < length; ++i) {
+         uint16_t opcode = opcodes[i];
+         uint8_t x = (opcode & 0x0F00) >> 8;
+         uint8_t y = (opcode & 0x00F0) >> 4;
+         switch(opcode & 0xF000) {
+             case 0x3000: case 0x4000: case 0x6000: case 0x7000:
+                 ++uses[x];
+                 break;
+             case 0x5000: case 0x9000:
+                 ++uses[x];
+                 ++uses[y];
+                 break;
+             case 0x8000:
+                 ++uses[x];
+                 ++uses[y];
+                 uses[0xF] += (opcode & 0xF) != 0 && ((opcode & 0xF) > 3 || quirks.vfReset);
+                 break;
+             case 0xB000:
+                 ++uses[quirks.jumpVx ? x : 0];
+                 break;
+             case 0xF000:
+                 if((opcode & 0xFF) == 0x55 || (opcode & 0xFF) == 0x65) {
+                     for(int v = 0; v <= x; ++v) {
+                         ++uses[v];
+                     }
+                 }
+                 else {
+                     ++uses[x];
+                 }
+                 break;
+         }
+     }
+     for(int v = 0; v < 16; ++v) {
+         hostReg[v] = -1;
+     }
+     for(int r = 0; r < CACHE_REGS; ++r) {
+         int best = -1;
+         for(int v = 0; v < 16; ++v) {
+             if(hostReg[v] < 0 && uses[v] >= 2 && (best < 0 || uses[v] > uses[best])) {
+                 best = v;
+             }
+         }
+         if(best < 0) {
+             break;
+         }
+         hostReg[best] = cacheRegs[r];
+     }
+     dirty = 0;
+ }
+
+ void Chip8Jit::emitInstruction(uint16_t opcode, uint16_t pc, const Chip8QuirkSet& quirks) {
+     uint8_t x = (opcode & 0x0F00) >> 8;
+     uint8_t y = (opcode & 0x00F0) >> 4;
+     uint8_t kk = opcode & 0x00FF;
+     uint8_t n = opcode & 0x000F;
+     uint16_t nnn = opcode & 0x0FFF;
+     static const uint8_t aluOps[4] = {0x88, 0x08, 0x20, 0x30};    //mov, or, and, xor
+
+     switch (opcode & 0xF000) {
+         case 0x1000:    //JP addr
+             emitReturn(nnn);
+             return;
+
+         case 0x3000:    //SE Vx, byte
+         case 0x4000:    //SNE Vx, byte
+             emitV(0x80, -1, 7, x); emit8(kk);                           //cmp Vx, kk
+             emitSkip((opcode & 0xF000) == 0x3000 ? 0x75 : 0x74, pc);
+             return;
+
+         case 0x5000:    //SE Vx, Vy
+         case 0x9000:    //SNE Vx, Vy
+             emitV(0x8A, -1, REG_AX, y);                                 //mov al, Vy
+             emitV(0x38, -1, REG_AX, x);                                 //cmp Vx, al
+             emitSkip((opcode & 0xF000) == 0x5000 ? 0x75 : 0x74, pc);
+             return;
+
+         case 0x6000:    //LD Vx, byte
+             emitV(0xC6, -1, 0, x); emit8(kk);                           //mov Vx, kk
+             dirty |= 1 << x;
+             return;
+
+         case 0x7000:    //ADD Vx, byte
+             emitV(0x80, -1, 0, x); emit8(kk);                           //add Vx, kk
+             dirty |= 1 << x;
+             return;
+
+         case 0x8000: {
+             //The shifts take Vx, or Vy under the VIP profile; everything else starts from Vy
+             uint8_t source = (n == 0x6 || n == 0xE) && !quirks.shiftVy ? x : y;
+             emitV(0x8A, -1, REG_AX, source);                            //mov al, source
+             switch(n) {
+                 case 0x0: case 0x1: case 0x2: case 0x3:                 //LD, OR, AND, XOR Vx, Vy
+                     emitV(aluOps[n], -1, REG_AX, x);                    //op Vx, al
+                     if(quirks.vfReset && n != 0) {
+                         emitV(0xC6, -1, 0, 0xF); emit8(0);              //mov VF, 0
+                         dirty |= 1 << 0xF;
+                     }
+                     break;
+                 case 0x4:                                               //ADD Vx, Vy: VF = carry
+                     emitV(0x00, -1, REG_AX, x);                         //add Vx, al
+                     emitV(0x0F, 0x92, 0, 0xF);                          //setc VF
+                     break;
+                 case 0x5:                                               //SUB Vx, Vy: VF = NOT borrow
+                     emitV(0x28, -1, REG_AX, x);                         //sub Vx, al
+                     emitV(0x0F, 0x93, 0, 0xF);                          //setnc VF
+                     break;
+                 case 0x7:                                               //SUBN Vx, Vy: VF = NOT borrow
+                     emitV(0x2A, -1, REG_AX, x);                         //sub al, Vx
+                     emitV(0x88, -1, REG_AX, x);                         //mov Vx, al
+                     emitV(0x0F, 0x93, 0, 0xF);                          //setnc VF
+                     break;
+                 case 0x6:                                               //SHR Vx {, Vy}: VF = bit shifted out
+                 case 0xE:                                               //SHL Vx {, Vy}
+                     emit8(0x40); emit8(0xD0); emit8(n == 6 ? 0xE8 : 0xE0);  //shr/shl al, 1
+                     emitV(0x88, -1, REG_AX, x);                         //mov Vx, al
+                     emitV(0x0F, 0x92, 0, 0xF);                          //setc VF
+                     break;
+             }
+             //The flag goes in last, so it wins when x is F
+             dirty |= 1 << x | (n != 0 && (n > 3 || quirks.vfReset)) << 0xF;
+             return;
+         }
+
+         case 0xA000:    //LD I, addr
+             emit8(0x41); emit8(0xB8); emit32(nnn);                      //mov r8d, nnn
+             return;
+
+         case 0xB000:    //JP V0, addr (JP Vx, xnn with the jump quirk)
+             emitV(0x0F, 0xB6, REG_AX, quirks.jumpVx ? x : 0);           //movzx eax, V0 or Vx
+             emit8(0x05); emit32(nnn);                                   //add eax, nnn
+             emitExit();
+             emit8(0xC3);                                                //ret
+             return;
+
+         case 0xF000:
+             switch(kk) {
+                 case 0x07:      //LD Vx, DT
+                     emitState(0x8A, -1, REG_AX, offsetof(Chip8State, delayTimer));  //mov al, DT
+                     emitV(0x88, -1, REG_AX, x);                                     //mov Vx, al
+                     dirty |= 1 << x;
+                     return;
+                 case 0x15:      //LD DT, Vx
+                 case 0x18:      //LD ST, Vx
+                     emitV(0x8A, -1, REG_AX, x);                                     //mov al, Vx
+                     emitState(0x88, -1, REG_AX, kk == 0x15 ? offsetof(Chip8State, delayTimer)
+                                                            : offsetof(Chip8State, soundTimer));
+                     return;
+                 case 0x1E:      //ADD I, Vx
+                     emitV(0x0F, 0xB6, REG_AX, x);                               //movzx eax, Vx
+                     emit8(0x66); emit8(0x41); emit8(0x01); emit8(0xC0);         //add r8w, ax
+                     return;
+                 case 0x55:      //LD [I], Vx
+                 case 0x65:      //LD Vx, [I]
+                     for(int v = 0; v <= x; ++v) {
+                         emitIndex(v);
+                         if(kk == 0x55) {
+                             emitV(0x8A, -1, REG_AX, v);                         //mov al, Vv
+                             emitMemory(0x88, REG_AX);                           //mov [memory + r11], al
+                         }
+                         else {
+                             emitMemory(0x8A, REG_AX);                           //mov al, [memory + r11]
+                             emitV(0x88, -1, REG_AX, v);                         //mov Vv, al
+                         }
+                     }
+                     if(kk == 0x65) {
+                         dirty |= (2 << x) - 1;
+                     }
+                     if(quirks.loadStoreI != I_KEEP) {
+                         uint8_t advance = x + (quirks.loadStoreI == I_ADD_X_PLUS_1);
+                         emit8(0x66); emit8(0x41); emit8(0x83); emit8(0xC0); emit8(advance);  //add r8w, advance
+                     }
+                     if(kk == 0x55) {
+                         emitReturn(pc + 2);
+                     }
+                     return;
+             }
+             return;
+     }
+ }
+
+ void Chip8Jit::translate(Chip8& chip8, uint16_t start) {
+     //Fx55 and Fx65 with x = F are the longest instructions, at about 400 bytes
+     const size_t maxBlockBytes = 256 + MAX_BLOCK_LENGTH * 512;
+     if(codeUsed + maxBlockBytes > CODE_SIZE) {
+         flush();
+     }
+
+     Block& block = blocks[start];
+     Chip8QuirkSet quirks = Chip8Core::quirkSet(chip8.state.quirks);
+
+     //Find the block's extent first, so the register allocation can see all of it
+     uint16_t opcodes[MAX_BLOCK_LENGTH];
+     int length = 0;
+     bool terminated = false;
+     uint16_t pc = start;
+     while(!terminated && length < MAX_BLOCK_LENGTH && pc < chip8.state.endOfRom && pc < 0xFFF) {
+         uint16_t opcode = chip8.state.memory[pc] << 8 | chip8.state.memory[pc + 1];
+         if(!compilable(opcode)) {
+             break;
+         }
+         opcodes[length++] = opcode;
+         terminated = terminates(opcode);
+         pc += 2;
+     }
+     if(length == 0) {
+         block.state = INTERPRET;
+         return;
+     }
+
+     uint8_t* blockStart = code + codeUsed;
+     emitPtr = blockStart;
+     allocate(opcodes, length, quirks);
+     emitState(0x0F, 0xB7, REG_I, offsetof(Chip8State, I));                  //movzx r8d, word [I]
+     for(int v = 0; v < 16; ++v) {
+         if(hostReg[v] >= 0) {
+             emitState(0x8A, -1, hostReg[v], offsetof(Chip8State, V) + v);   //mov reg, [V + v]
+         }
+     }
+
+     block.sounds = false;
+     block.stored = 0;
+     block.storeAdvance = 0;
+     STATS(for(int i = 0; i < 16; ++i) block.classes[i] = 0);
+     STATS(block.skipPc = 0);
+     pc = start;
+     for(int i = 0; i < length; ++i, pc += 2) {
+         uint16_t opcode = opcodes[i];
+         emitInstruction(opcode, pc, quirks);
+         block.sounds |= (opcode & 0xF0FF) == 0xF018;
+         if((opcode & 0xF0FF) == 0xF055) {
+             uint8_t x = (opcode & 0x0F00) >> 8;
+             block.stored = x + 1;
+             block.storeAdvance = quirks.loadStoreI == I_KEEP ? 0 : x + (quirks.loadStoreI == I_ADD_X_PLUS_1);
+         }
+         STATS(++block.classes[opcode >> 12]);
+         STATS(if(flowKind(opcode) == FLOW_SKIP) block.skipPc = pc);
+         covered[pc] = true;
+         covered[pc + 1] = true;
+     }
+     if(!terminated) {
+         emitReturn(pc);
+     }
+     block.fn = (BlockFn)blockStart;
+     block.length = length;
+     block.state = NATIVE;
+     codeUsed += emitPtr - blockStart;
+ }
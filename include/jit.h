@@ -0,0 +1,93 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstdint>
+ #include <cstddef>
+ #include "core.h"
+ #include "stats.h"
+
+ class Chip8;
+
+ /*
+  *  Basic-block recompiler for x86-64 hosts.
+  *
+  *  A block is a run of straight-line instructions that only touch the
+  *  registers, I, the timers and memory through Fx65: 6xkk, 7xkk, 8xyn,
+  *  Annn, Fx07, Fx15, Fx18, Fx1E and Fx65. It is closed by a 1nnn, Bnnn,
+  *  3xkk/4xkk/5xy0/9xy0 or Fx55 terminator. Anything that touches the
+  *  stack, keyboard, screen or RNG ends the block before it and is left to
+  *  the interpreter, so a block never observes state the interpreter would
+  *  have changed between its instructions. Fx55 is always last, so no block
+  *  runs code it has just written over; run() drops whatever the store hit.
+  *  A block only runs when it fits in the cycle budget left in the current
+  *  frame, and one holding an Fx18 is left to the interpreter while the
+  *  beeper is listening for edges.
+  *
+  *  Blocks are built for the machine's quirk profile; init() and loadState()
+  *  flush them, so a profile change never runs stale code.
+  *
+  *  Generated code takes the Chip8State and returns the next PC in eax. I
+  *  lives in r8w and the block's most used V registers in the spare
+  *  caller-saved registers. They are loaded on entry and the ones written
+  *  are stored back at the single exit.
+  */
+ class Chip8Jit {
+    public:
+        Chip8Jit();
+        ~Chip8Jit();
+        bool available() const {return code != NULL;}
+        //Runs blocks back to back from the pc until the next one does not fit
+        //before cycleLimit or the pc must be interpreted, skipping idle passes
+        //with idle if given. false if none ran.
+        bool run(Chip8& chip8, uint64_t cycleLimit, Chip8IdleLoop* idle);
+        void invalidate(uint16_t addr);     //memory at addr was written
+        void flush();
+
+    private:
+        typedef uint32_t (*BlockFn)(Chip8State* s);
+
+        enum BlockState : uint8_t { UNTRANSLATED, NATIVE, INTERPRET };
+
+        struct Block {
+            BlockFn fn;
+            uint16_t length;        //CHIP-8 instructions in the block
+            BlockState state;
+            bool sounds;            //Holds an Fx18, which the beeper needs to see
+            uint8_t stored;         //Bytes the closing Fx55 writes, 0 if none
+            uint8_t storeAdvance;   //What that Fx55 added to I after storing
+ #ifdef CHIP8_STATS
+            uint8_t classes[16];    //Instructions per high nibble
+            uint16_t skipPc;        //Address of the closing skip, 0 if none
+ #endif
+        };
+
+        static const size_t CODE_SIZE = 1 << 20;
+        static const int MAX_BLOCK_LENGTH = 64;
+
+        uint8_t* code;
+        size_t codeUsed;
+        Block blocks[0x1000];
+        bool covered[0x1000];               //Bytes some native block was built from
+
+        void translate(Chip8& chip8, uint16_t start);
+        void emitInstruction(uint16_t opcode, uint16_t pc, const Chip8QuirkSet& quirks);
+
+        //Register allocation for the block being emitted
+        int8_t hostReg[16];                 //Host register holding V[i], -1 for none
+        uint16_t dirty;                     //Cached registers written, bit i = V[i]
+        void allocate(const uint16_t* opcodes, int length, const Chip8QuirkSet& quirks);
+
+        uint8_t* emitPtr;
+        void emit8(uint8_t b) {*emitPtr++ = b;}
+        void emit32(uint32_t v);
+        void emitV(uint8_t op1, int op2, uint8_t reg, int v);
+        void emitState(uint8_t op1, int op2, uint8_t reg, uint32_t offset);
+        void emitMemory(uint8_t op, uint8_t reg);
+        void emitIndex(int i);
+        void emitExit();
+        void emitReturn(uint32_t nextPc);
+        void emitSkip(uint8_t jcc, uint16_t pc);
+ };
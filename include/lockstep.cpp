@@ -0,0 +1,556 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "lockstep.h"
+ #include <cstring>
+
+ //The vector helpers are file-local and inlined, so GCC's warning about the
+ //vector calling convention changing with -mavx does not apply
+ #pragma GCC diagnostic ignored "-Wpsabi"
+
+ typedef Chip8Lockstep::LaneU8 LaneU8;
+ typedef Chip8Lockstep::LaneI8 LaneI8;
+ typedef Chip8Lockstep::LaneU16 LaneU16;
+ typedef Chip8Lockstep::LaneI16 LaneI16;
+ typedef Chip8Lockstep::LaneU64 LaneU64;
+ typedef Chip8Lockstep::LaneI64 LaneI64;
+
+ const int LANES = Chip8Lockstep::LANES;
+
+ //a where the mask is set, b elsewhere
+ static inline LaneU8 select(const LaneI8& m, const LaneU8& a, const LaneU8& b) {
+     return (LaneU8)(((LaneI8)a & m) | ((LaneI8)b & ~m));
+ }
+
+ static inline LaneU16 select(const LaneI16& m, const LaneU16& a, const LaneU16& b) {
+     return (LaneU16)(((LaneI16)a & m) | ((LaneI16)b & ~m));
+ }
+
+ static inline LaneI16 widen(const LaneI8& m) {
+     return __builtin_convertvector(m, LaneI16);
+ }
+
+ static inline LaneI8 narrow(const LaneI16& m) {
+     return __builtin_convertvector(m, LaneI8);
+ }
+
+ //Element l of a lane vector through a plain pointer. Subscripting the vector
+ //itself makes GCC spill the whole vector to the stack to reach one element.
+ static inline uint8_t& lane(LaneU8& v, int l) {return ((uint8_t*)&v)[l];}
+ static inline int8_t& lane(LaneI8& v, int l) {return ((int8_t*)&v)[l];}
+ static inline uint16_t& lane(LaneU16& v, int l) {return ((uint16_t*)&v)[l];}
+ static inline uint64_t& lane(LaneU64& v, int l) {return ((uint64_t*)&v)[l];}
+ static inline uint8_t lane(const LaneU8& v, int l) {return ((const uint8_t*)&v)[l];}
+ static inline int8_t lane(const LaneI8& v, int l) {return ((const int8_t*)&v)[l];}
+ static inline uint16_t lane(const LaneU16& v, int l) {return ((const uint16_t*)&v)[l];}
+ static inline uint64_t lane(const LaneU64& v, int l) {return ((const uint64_t*)&v)[l];}
+
+ Chip8Lockstep::Chip8Lockstep(Chip8Quirks quirks) {
+     profile = quirks;
+     this->quirks = Chip8Core::quirkSet(quirks);
+     steps = 0;
+     //Every lane starts parked until load() fills it
+     memset((void*)this->V, 0, sizeof(V));
+     I = pc = endOfRom = keys = LaneU16{};
+     sp = delayTimer = soundTimer = LaneU8{};
+     keyWait = fault = active = LaneI8{};
+     memset((void*)screen, 0, sizeof(screen));
+     memset(stack, 0, sizeof(stack));
+     memset(memory, 0, sizeof(memory));
+     memset(rng, 0, sizeof(rng));
+     memset(cycles, 0, sizeof(cycles));
+     memset(retired, 0, sizeof(retired));
+     memset(keyboard, 0, sizeof(keyboard));
+     memset(keyRegister, 0, sizeof(keyRegister));
+     remix = true;
+ }
+
+ void Chip8Lockstep::load(int l, const Chip8State& snapshot) {
+     memcpy(memory[l], snapshot.memory, sizeof(snapshot.memory));
+     memcpy(stack[l], snapshot.stack, sizeof(snapshot.stack));
+     for(int r = 0; r < 32; ++r) {
+         lane(screen[r], l) = snapshot.screen[r];
+     }
+     for(int i = 0; i < 16; ++i) {
+         lane(V[i], l) = snapshot.V[i];
+     }
+     lane(I, l) = snapshot.I;
+     lane(pc, l) = snapshot.pc;
+     lane(sp, l) = snapshot.sp;
+     lane(delayTimer, l) = snapshot.delayTimer;
+     lane(soundTimer, l) = snapshot.soundTimer;
+     lane(endOfRom, l) = snapshot.endOfRom;
+     lane(keyWait, l) = snapshot.keyWait ? -1 : 0;
+     keyRegister[l] = snapshot.keyRegister;
+     keyboard[l] = snapshot.keys;
+     rng[l] = snapshot.rngState;
+     cycles[l] = snapshot.cycles;
+     lane(fault, l) = snapshot.fault;
+     lane(active, l) = -1;
+     remix = true;
+ }
+
+ void Chip8Lockstep::store(int l, Chip8State& snapshot) const {
+     memcpy(snapshot.memory, memory[l], sizeof(snapshot.memory));
+     memcpy(snapshot.stack, stack[l], sizeof(snapshot.stack));
+     for(int r = 0; r < 32; ++r) {
+         snapshot.screen[r] = lane(screen[r], l);
+     }
+     for(int i = 0; i < 16; ++i) {
+         snapshot.V[i] = lane(V[i], l);
+     }
+     snapshot.I = lane(I, l);
+     snapshot.pc = lane(pc, l);
+     snapshot.sp = lane(sp, l);
+     snapshot.delayTimer = lane(delayTimer, l);
+     snapshot.soundTimer = lane(soundTimer, l);
+     snapshot.endOfRom = lane(endOfRom, l);
+     snapshot.keyWait = lane(keyWait, l) != 0;
+     snapshot.fault = (Chip8Fault)lane(fault, l);
+     snapshot.keyRegister = keyRegister[l];
+     snapshot.keys = keyboard[l];
+     snapshot.rngState = rng[l];
+     snapshot.cycles = cycles[l];
+     snapshot.dirtyRows = 0xFFFFFFFF;
+     snapshot.quirks = profile;
+ }
+
+ uint64_t Chip8Lockstep::frameHash(int l) const {
+     uint64_t rows[32];
+     for(int r = 0; r < 32; ++r) {
+         rows[r] = lane(screen[r], l);
+     }
+     return Chip8Core::hashRows(rows);
+ }
+
+ bool Chip8Lockstep::resumeOnKey(int l) {
+     for(int i = 0; i < 16; ++i) {
+         if((keyboard[l] >> i) & 1) {
+             V[keyRegister[l]][l] = i;
+             lane(keyWait, l) = 0;
+             lane(pc, l) += 2;
+             return true;
+         }
+     }
+     return false;
+ }
+
+ void Chip8Lockstep::writeMemory(int l, int addr, uint8_t value) {
+     addr &= 0xFFF;
+     memory[l][addr] = value;
+     mixed[addr] = true;
+ }
+
+ void Chip8Lockstep::runFrame(uint32_t instructions, const Chip8KeyEvent* changes, size_t count) {
+     if(remix) {
+         //Only lanes that can run count: parked lanes hold zeroed memory,
+         //which would mark nearly every byte of the ROM as mixed
+         uint32_t lanes = 0;
+         for(int l = 0; l < LANES; ++l) {
+             lanes |= (uint32_t)(lane(active, l) != 0) << l;
+         }
+         memset(mixed, 0, sizeof(mixed));
+         if(lanes != 0) {
+             int first = __builtin_ctz(lanes);
+             for(uint32_t rest = lanes & (lanes - 1); rest != 0; rest &= rest - 1) {
+                 int l = __builtin_ctz(rest);
+                 for(int a = 0; a < 0x1000; ++a) {
+                     mixed[a] |= memory[l][a] != memory[first][a];
+                 }
+             }
+         }
+         remix = false;
+     }
+
+     //Lanes with instructions to run this frame, as if runFrame() had been called on each
+     uint32_t running = 0;
+     for(int l = 0; l < LANES; ++l) {
+         lane(keys, l) = keyboard[l];
+         retired[l] = 0;
+         if(lane(active, l) && !lane(fault, l) && lane(pc, l) < lane(endOfRom, l)) {
+             running |= 1u << l;
+         }
+     }
+
+     //Same segments as Chip8::runFrame(): run up to each key change, then apply it
+     for(size_t next = 0; ; ++next) {
+         for(uint32_t rest = running; rest != 0; rest &= rest - 1) {
+             int l = __builtin_ctz(rest);
+             if(lane(keyWait, l)) {
+                 resumeOnKey(l);
+             }
+         }
+         advance(running, next < count && changes[next].cycle < instructions ? changes[next].cycle : instructions);
+         if(next == count) {
+             break;
+         }
+         for(int l = 0; l < LANES; ++l) {
+             keyboard[l] = changes[next].keys;
+             lane(keys, l) = changes[next].keys;
+         }
+     }
+
+     //The timers count down on every active lane, ended and faulted ones included,
+     //as Chip8::runFrame() ticks them whether or not anything ran
+     LaneU8 tick = (LaneU8)active & 1;
+     delayTimer -= (LaneU8)(delayTimer > 0) & tick;
+     soundTimer -= (LaneU8)(soundTimer > 0) & tick;
+ }
+
+ void Chip8Lockstep::advance(uint32_t frameLanes, uint32_t until) {
+     while(true) {
+         //Group = the lanes still owed instructions that sit on the lowest pc.
+         //Lanes that finished the segment stay finished, so drop them for good.
+         uint16_t groupPc = 0xFFFF;
+         uint32_t lanes = 0;
+         for(uint32_t rest = frameLanes; rest != 0; rest &= rest - 1) {
+             int l = __builtin_ctz(rest);
+             if(retired[l] >= until || lane(keyWait, l) || lane(fault, l) || lane(pc, l) >= lane(endOfRom, l)) {
+                 frameLanes &= ~(1u << l);
+             }
+             else if(lane(pc, l) < groupPc) {
+                 groupPc = lane(pc, l);
+                 lanes = 1u << l;
+             }
+             else if(lane(pc, l) == groupPc) {
+                 lanes |= 1u << l;
+             }
+         }
+         if(lanes == 0) {
+             break;
+         }
+
+         int leader = __builtin_ctz(lanes);
+         uint32_t budget = until;
+         uint16_t end = 0xFFFF;     //Lowest endOfRom in the group, so no lane runs past its own
+         LaneI8 m = {};
+         for(uint32_t rest = lanes; rest != 0; rest &= rest - 1) {
+             int l = __builtin_ctz(rest);
+             lane(m, l) = -1;
+             budget = until - retired[l] < budget ? until - retired[l] : budget;
+             end = lane(endOfRom, l) < end ? lane(endOfRom, l) : end;
+         }
+
+         //Run the group until a control transfer, the end of the ROM or the frame budget
+         uint32_t run = 0;
+         bool pcStale = false;      //Group lanes' pc lags groupPc
+         while(run < budget && groupPc < end) {
+             uint16_t opcode = memory[leader][groupPc] << 8 | memory[leader][(groupPc + 1) & 0xFFF];
+             if(mixed[groupPc] || mixed[(groupPc + 1) & 0xFFF]) {
+                 //Possibly self-modified code: split off lanes that hold a different opcode
+                 uint32_t same = lanes;
+                 for(uint32_t rest = lanes; rest != 0; rest &= rest - 1) {
+                     int l = __builtin_ctz(rest);
+                     if((memory[l][groupPc] << 8 | memory[l][(groupPc + 1) & 0xFFF]) != opcode) {
+                         same &= ~(1u << l);
+                     }
+                 }
+                 if(same != lanes) {
+                     if(run > 0) {
+                         break;
+                     }
+                     for(uint32_t rest = lanes & ~same; rest != 0; rest &= rest - 1) {
+                         lane(m, __builtin_ctz(rest)) = 0;
+                     }
+                     lanes = same;
+                 }
+             }
+
+             StepKind kind = executeData(opcode, m, lanes);
+             ++run;
+             if(kind == STEP_NEXT) {
+                 groupPc += 2;
+                 pcStale = true;
+             }
+             else if(kind == STEP_FAULT) {
+                 if(pcStale) {
+                     pc = select(widen(m), (LaneU16){} + groupPc, pc);
+                     pcStale = false;
+                 }
+                 for(uint32_t rest = lanes; rest != 0; rest &= rest - 1) {
+                     lane(fault, __builtin_ctz(rest)) = FAULT_BAD_OPCODE;
+                 }
+                 break;
+             }
+             else if(kind == STEP_CONTROL) {
+                 if(pcStale) {
+                     pc = select(widen(m), (LaneU16){} + groupPc, pc);
+                     pcStale = false;
+                 }
+                 executeControl(opcode, m, lanes);
+                 break;
+             }
+         }
+         if(pcStale) {
+             pc = select(widen(m), (LaneU16){} + groupPc, pc);
+         }
+
+         for(uint32_t rest = lanes; rest != 0; rest &= rest - 1) {
+             int l = __builtin_ctz(rest);
+             retired[l] += run;
+             cycles[l] += run;
+         }
+         ++steps;
+     }
+ }
+
+ void Chip8Lockstep::drawSprite(int l, uint16_t opcode) {
+     uint8_t x = lane(V[(opcode >> 8) & 0xF], l) & 63;
+     uint8_t y = lane(V[(opcode >> 4) & 0xF], l) & 31;
+     uint64_t collision = 0;
+     for(int yOffset = 0; yOffset < (opcode & 0xF); ++yOffset) {
+         int row = y + yOffset;
+         if(row >= 32) {
+             if(!quirks.wrapSprites) {
+                 break;
+             }
+             row &= 31;
+         }
+         uint64_t sprite = (uint64_t)memory[l][(lane(I, l) + yOffset) & 0xFFF] << 56;
+         uint64_t bits = sprite >> x;
+         if(quirks.wrapSprites && x != 0) {
+             bits |= sprite << (64 - x);
+         }
+         collision |= lane(screen[row], l) & bits;
+         lane(screen[row], l) ^= bits;
+     }
+     lane(V[0xF], l) = collision != 0;
+ }
+
+ void Chip8Lockstep::advanceIndex(const LaneI8& m, uint8_t x) {
+     //What Fx55/Fx65 leave in I
+     if(quirks.loadStoreI != I_KEEP) {
+         uint16_t step = quirks.loadStoreI == I_ADD_X ? x : x + 1;
+         I = select(widen(m), I + step, I);
+     }
+ }
+
+ Chip8Lockstep::StepKind Chip8Lockstep::executeData(uint16_t opcode, const LaneI8& m, uint32_t lanes) {
+     uint8_t x = (opcode & 0x0F00) >> 8;
+     uint8_t y = (opcode & 0x00F0) >> 4;
+     uint8_t kk = opcode & 0x00FF;
+     uint16_t nnn = opcode & 0x0FFF;
+     LaneU8& Vx = V[x];
+     LaneU8& Vy = V[y];
+     LaneU8& VF = V[0xF];
+
+     //Each statement mirrors the scalar handler in core.cpp, in the same
+     //order, so aliasing (x or y being F) behaves the same
+     switch(opcode >> 12) {
+         case 0x0:
+             if(kk == 0xE0) {
+                 LaneI64 m64 = __builtin_convertvector(m, LaneI64);
+                 for(int r = 0; r < 32; ++r) {
+                     screen[r] &= (LaneU64)~m64;
+                 }
+                 return STEP_NEXT;
+             }
+             return kk == 0xEE ? STEP_CONTROL : STEP_FAULT;
+
+         case 0x6:
+             Vx = select(m, (LaneU8){} + kk, Vx);
+             return STEP_NEXT;
+
+         case 0x7:
+             Vx = select(m, Vx + kk, Vx);
+             return STEP_NEXT;
+
+         case 0x8:
+             switch(opcode & 0xF) {
+                 case 0x0: Vx = select(m, Vy, Vx); break;
+                 case 0x1:
+                     Vx = select(m, Vx | Vy, Vx);
+                     VF = quirks.vfReset ? select(m, (LaneU8){}, VF) : VF;
+                     break;
+                 case 0x2:
+                     Vx = select(m, Vx & Vy, Vx);
+                     VF = quirks.vfReset ? select(m, (LaneU8){}, VF) : VF;
+                     break;
+                 case 0x3:
+                     Vx = select(m, Vx ^ Vy, Vx);
+                     VF = quirks.vfReset ? select(m, (LaneU8){}, VF) : VF;
+                     break;
+                 //Flags are computed first and written last, as in the interpreter, so they win when x is F
+                 case 0x4: {
+                     LaneU8 sum = Vx + Vy;
+                     LaneU8 flag = (LaneU8)(sum < Vx) & 1;
+                     Vx = select(m, sum, Vx);
+                     VF = select(m, flag, VF);
+                     break;
+                 }
+                 case 0x5: {
+                     LaneU8 flag = (LaneU8)(Vx >= Vy) & 1;
+                     Vx = select(m, Vx - Vy, Vx);
+                     VF = select(m, flag, VF);
+                     break;
+                 }
+                 case 0x6: {
+                     LaneU8& source = quirks.shiftVy ? Vy : Vx;
+                     LaneU8 flag = source & 1;
+                     Vx = select(m, source >> 1, Vx);
+                     VF = select(m, flag, VF);
+                     break;
+                 }
+                 case 0x7: {
+                     LaneU8 flag = (LaneU8)(Vy >= Vx) & 1;
+                     Vx = select(m, Vy - Vx, Vx);
+                     VF = select(m, flag, VF);
+                     break;
+                 }
+                 case 0xE: {
+                     LaneU8& source = quirks.shiftVy ? Vy : Vx;
+                     LaneU8 flag = source >> 7;
+                     Vx = select(m, source << 1, Vx);
+                     VF = select(m, flag, VF);
+                     break;
+                 }
+                 default:
+                     return STEP_FAULT;     //8xy8-8xyD and 8xyF
+             }
+             return STEP_NEXT;
+
+         case 0xA:
+             I = select(widen(m), (LaneU16){} + nnn, I);
+             return STEP_NEXT;
+
+         case 0xC:
+             for(; lanes != 0; lanes &= lanes - 1) {
+                 int l = __builtin_ctz(lanes);
+                 lane(Vx, l) = Chip8Core::nextRandom(rng[l]) & kk;
+             }
+             return STEP_NEXT;
+
+         case 0xD:
+             for(; lanes != 0; lanes &= lanes - 1) {
+                 drawSprite(__builtin_ctz(lanes), opcode);
+             }
+             return STEP_NEXT;
+
+         case 0xE:
+             return kk == 0x9E || kk == 0xA1 ? STEP_CONTROL : STEP_FAULT;
+
+         case 0xF:
+             switch(kk) {
+                 case 0x07: Vx = select(m, delayTimer, Vx); break;
+                 case 0x15: delayTimer = select(m, Vx, delayTimer); break;
+                 case 0x18: soundTimer = select(m, Vx, soundTimer); break;
+                 case 0x1E: I = select(widen(m), I + __builtin_convertvector(Vx, LaneU16), I); break;
+                 case 0x29: I = select(widen(m), __builtin_convertvector(Vx & 0xF, LaneU16) * 5 + 0x050, I); break;
+                 case 0x0A:
+                     return STEP_CONTROL;
+                 case 0x33:
+                     for(; lanes != 0; lanes &= lanes - 1) {
+                         int l = __builtin_ctz(lanes);
+                         writeMemory(l, lane(I, l),     lane(Vx, l) / 100);
+                         writeMemory(l, lane(I, l) + 1, (lane(Vx, l) / 10) % 10);
+                         writeMemory(l, lane(I, l) + 2, (lane(Vx, l) % 100) % 10);
+                     }
+                     break;
+                 case 0x55:
+                     for(; lanes != 0; lanes &= lanes - 1) {
+                         int l = __builtin_ctz(lanes);
+                         for(int j = 0; j <= x; ++j) {
+                             writeMemory(l, lane(I, l) + j, lane(V[j], l));
+                         }
+                     }
+                     advanceIndex(m, x);
+                     break;
+                 case 0x65:
+                     for(; lanes != 0; lanes &= lanes - 1) {
+                         int l = __builtin_ctz(lanes);
+                         for(int j = 0; j <= x; ++j) {
+                             lane(V[j], l) = memory[l][(lane(I, l) + j) & 0xFFF];
+                         }
+                     }
+                     advanceIndex(m, x);
+                     break;
+                 default:
+                     return STEP_FAULT;
+             }
+             return STEP_NEXT;
+
+         default:
+             return STEP_CONTROL;    //1nnn, 2nnn, 3xkk, 4xkk, 5xy0, 9xy0, Bnnn
+     }
+ }
+
+ void Chip8Lockstep::executeControl(uint16_t opcode, const LaneI8& m, uint32_t lanes) {
+     uint8_t x = (opcode & 0x0F00) >> 8;
+     uint8_t y = (opcode & 0x00F0) >> 4;
+     uint8_t kk = opcode & 0x00FF;
+     uint16_t nnn = opcode & 0x0FFF;
+     LaneU8& Vx = V[x];
+     LaneU8& Vy = V[y];
+     LaneU16 next = pc + 2;
+
+     switch(opcode >> 12) {
+         case 0x0:   //00EE
+             for(; lanes != 0; lanes &= lanes - 1) {
+                 int l = __builtin_ctz(lanes);
+                 if(lane(sp, l) == 0) {
+                     lane(fault, l) = FAULT_STACK_UNDERFLOW;
+                     continue;
+                 }
+                 --lane(sp, l);
+                 lane(pc, l) = stack[l][lane(sp, l)] + 2;
+             }
+             return;
+
+         case 0x1:
+             next = (LaneU16){} + nnn;
+             break;
+
+         case 0x2:
+             for(; lanes != 0; lanes &= lanes - 1) {
+                 int l = __builtin_ctz(lanes);
+                 if(lane(sp, l) >= 16) {
+                     lane(fault, l) = FAULT_STACK_OVERFLOW;
+                     continue;
+                 }
+                 stack[l][lane(sp, l)] = lane(pc, l);
+                 ++lane(sp, l);
+                 lane(pc, l) = nnn;
+             }
+             return;
+
+         case 0x3:
+             next += (LaneU16)widen(Vx == kk) & 2;
+             break;
+
+         case 0x4:
+             next += (LaneU16)widen(Vx != kk) & 2;
+             break;
+
+         case 0x5:
+             next += (LaneU16)widen(Vx == Vy) & 2;
+             break;
+
+         case 0x9:
+             next += (LaneU16)widen(Vx != Vy) & 2;
+             break;
+
+         case 0xB:
+             next = __builtin_convertvector(V[quirks.jumpVx ? x : 0], LaneU16) + nnn;
+             break;
+
+         case 0xE: {
+             //Keys beyond F count as up, as in the interpreter
+             LaneU16 key = __builtin_convertvector(Vx, LaneU16);
+             LaneI16 down = (((keys >> (key & 15)) & 1) != 0) & (key < 16);
+             next += (LaneU16)(kk == 0x9E ? down : ~down) & 2;
+             break;
+         }
+
+         default:    //Fx0A
+             for(; lanes != 0; lanes &= lanes - 1) {
+                 int l = __builtin_ctz(lanes);
+                 lane(keyWait, l) = -1;
+                 keyRegister[l] = x;
+                 resumeOnKey(l);
+             }
+             return;
+     }
+     pc = select(widen(m), next, pc);
+ }
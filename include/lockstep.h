@@ -0,0 +1,97 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include "core.h"
+ #include <cstdint>
+
+ /*
+  *  Runs LANES independent machines side by side, one per vector lane.
+  *
+  *  State is kept as structure-of-arrays: V0 for every lane is one vector,
+  *  V1 the next, and so on for I, pc, sp and the timers. The scheduler picks
+  *  the lowest pc among the lanes still owed instructions this frame and
+  *  runs every lane sitting on it as one group, with the other lanes masked
+  *  off. A group runs straight-line code until its next control transfer,
+  *  then the lanes are regrouped. Lanes that branch apart become separate
+  *  groups and merge again once their pcs meet, which for lanes running the
+  *  same ROM is usually within a few instructions.
+  *
+  *  Register, timer and skip instructions are pure vector code. The vector
+  *  types are GCC vector extensions, so the same source compiles to SSE2 by
+  *  default and to AVX2 or AVX-512 with -march. Calls, returns, RND, DRW,
+  *  the keyboard wait and the memory instructions index per-lane data and
+  *  loop over the lanes in the group.
+  *
+  *  Per-lane results match Chip8::runFrame() with the same inputs, faults
+  *  included: a lane that hits a bad opcode or a stack over/underflow stops
+  *  there, as the interpreter does.
+  */
+ class Chip8Lockstep {
+    public:
+        static const int LANES = 32;
+
+        Chip8Lockstep(Chip8Quirks quirks = QUIRKS_MODERN);
+        void load(int lane, const Chip8State& snapshot);   //The snapshot must use the engine's quirk profile
+        void store(int lane, Chip8State& snapshot) const;
+        void setKeys(int lane, uint16_t keys) {keyboard[lane] = keys;}     //Bit i = key i held
+        void setActive(int lane, bool on) {active[lane] = on ? -1 : 0; remix = true;}    //Inactive lanes are frozen
+
+        void runFrame(uint32_t instructions) {runFrame(instructions, NULL, 0);}    //Chip8::runFrame() on every active lane
+        void runFrame(uint32_t instructions, const Chip8KeyEvent* changes, size_t count);   //changes go to every lane
+
+        bool endEmulation(int lane) const {return pc[lane] >= endOfRom[lane];}
+        bool waitingForKey(int lane) const {return keyWait[lane] != 0;}
+        bool timersActive(int lane) const {return delayTimer[lane] > 0 || soundTimer[lane] > 0;}
+        bool faulted(int lane) const {return fault[lane] != 0;}
+        Chip8Fault faultKind(int lane) const {return (Chip8Fault)fault[lane];}
+        uint64_t cycleCount(int lane) const {return cycles[lane];}
+        uint64_t frameHash(int lane) const;
+        uint64_t groupSteps() const {return steps;}     //Vector steps executed, for occupancy figures
+
+        typedef uint8_t  LaneU8  __attribute__((vector_size(LANES)));
+        typedef int8_t   LaneI8  __attribute__((vector_size(LANES)));
+        typedef uint16_t LaneU16 __attribute__((vector_size(LANES * 2)));
+        typedef int16_t  LaneI16 __attribute__((vector_size(LANES * 2)));
+        typedef uint64_t LaneU64 __attribute__((vector_size(LANES * 8)));
+        typedef int64_t  LaneI64 __attribute__((vector_size(LANES * 8)));
+
+    private:
+        //Lane masks are 0 or -1 per lane
+        LaneU8 V[16];
+        LaneU16 I;
+        LaneU16 pc;
+        LaneU8 sp;
+        LaneU8 delayTimer;
+        LaneU8 soundTimer;
+        LaneU16 endOfRom;
+        LaneU16 keys;               //keyboard[] as a vector, refreshed each frame
+        LaneI8 keyWait;
+        LaneI8 fault;               //Chip8Fault, FAULT_NONE while running
+        LaneI8 active;
+        LaneU64 screen[32];         //Row r of every lane
+
+        uint16_t stack[LANES][16];
+        uint8_t memory[LANES][0x1000];
+        bool mixed[0x1000];         //Some lane may hold a different byte here than the others
+        bool remix;                 //A lane was loaded or (de)activated since mixed[] was computed
+        uint64_t rng[LANES];
+        uint64_t cycles[LANES];
+        uint32_t retired[LANES];    //Instructions run in the current frame
+        uint16_t keyboard[LANES];
+        uint8_t keyRegister[LANES];
+        Chip8Quirks profile;
+        Chip8QuirkSet quirks;       //Tested once per group step, not per lane
+        uint64_t steps;
+
+        bool resumeOnKey(int lane);
+        void advance(uint32_t lanes, uint32_t until);  //Runs lanes until each has retired until instructions this frame, or stops
+        enum StepKind {STEP_NEXT, STEP_FAULT, STEP_CONTROL};
+        StepKind executeData(uint16_t opcode, const LaneI8& mask, uint32_t lanes);
+        void executeControl(uint16_t opcode, const LaneI8& mask, uint32_t lanes);
+        void drawSprite(int lane, uint16_t opcode);
+        void advanceIndex(const LaneI8& mask, uint8_t x);
+        void writeMemory(int lane, int addr, uint8_t value);
+ };
@@ -0,0 +1,106 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "movie.h"
+ #include <cstdio>
+
+ void Movie::record(uint64_t frame, uint16_t keys, uint32_t cycle) {
+     if(frame >= length) {
+         length = frame + 1;
+     }
+     uint16_t current = events.empty() ? 0 : events.back().keys;
+     if(keys != current) {
+         events.push_back({frame, keys, cycle});
+     }
+ }
+
+ void Movie::truncate(uint64_t frame) {
+     while(!events.empty() && events.back().frame >= frame) {
+         events.pop_back();
+     }
+     if(length > frame) {
+         length = frame;
+     }
+ }
+
+ void Movie::changesAt(uint64_t frame, size_t& cursor, std::vector<Chip8KeyEvent>& changes) const {
+     changes.clear();
+     while(cursor < events.size() && events[cursor].frame <= frame) {
+         const Event& event = events[cursor++];
+         changes.push_back({event.frame == frame ? event.cycle : 0, event.keys});
+     }
+ }
+
+ bool Movie::save(const char* path) const {
+     FILE* out = fopen(path, "w");
+     if(out == NULL) {
+         printf("Error: Failed to write %s\n", path);
+         return false;
+     }
+     //Frame-aligned movies stay readable by version 1 tools
+     bool cycles = false;
+     for(const Event& event : events) {
+         cycles |= event.cycle != 0;
+     }
+     fprintf(out, "chip8-movie %d\n", cycles ? 2 : 1);
+     fprintf(out, "seed %llu\n", (unsigned long long)seed);
+     fprintf(out, "ipf %u\n", ipf);
+     if(quirks != QUIRKS_MODERN) {
+         fprintf(out, "quirks %s\n", quirksName(quirks));
+     }
+     for(const Event& event : events) {
+         if(event.cycle != 0) {
+             fprintf(out, "%llu:%u %04x\n", (unsigned long long)event.frame, event.cycle, event.keys);
+         }
+         else {
+             fprintf(out, "%llu %04x\n", (unsigned long long)event.frame, event.keys);
+         }
+     }
+     fprintf(out, "end %llu\n", (unsigned long long)length);
+     fclose(out);
+     return true;
+ }
+
+ bool Movie::load(const char* path) {
+     FILE* in = fopen(path, "r");
+     if(in == NULL) {
+         printf("Error: Failed to open %s\n", path);
+         return false;
+     }
+     unsigned version = 0;
+     unsigned long long seedValue = 0;
+     unsigned long long lengthValue = 0;
+     bool ok = fscanf(in, " chip8-movie %u", &version) == 1 && (version == 1 || version == 2)
+            && fscanf(in, " seed %llu", &seedValue) == 1
+            && fscanf(in, " ipf %u", &ipf) == 1;
+     char profile[16];
+     quirks = QUIRKS_MODERN;
+     if(ok && fscanf(in, " quirks %15s", profile) == 1) {
+         ok = parseQuirks(profile, quirks);
+     }
+     events.clear();
+     unsigned long long frame;
+     unsigned keys;
+     while(ok && fscanf(in, " %llu", &frame) == 1) {
+         unsigned cycle = 0;
+         if(version == 2 && fscanf(in, ":%u", &cycle) != 1) {
+             cycle = 0;
+         }
+         ok = fscanf(in, " %x", &keys) == 1;
+         if(!events.empty() && (frame < events.back().frame || (frame == events.back().frame && cycle < events.back().cycle))) {
+             ok = false;
+         }
+         events.push_back({frame, (uint16_t)keys, cycle});
+     }
+     ok = ok && fscanf(in, " end %llu", &lengthValue) == 1;
+     fclose(in);
+     if(!ok) {
+         printf("Error: %s is not a valid movie\n", path);
+         return false;
+     }
+     seed = seedValue;
+     length = lengthValue;
+     return true;
+ }
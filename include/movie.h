@@ -0,0 +1,51 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstddef>
+ #include <cstdint>
+ #include <vector>
+ #include "core.h"
+
+ /*
+  *  Input movie: everything needed to replay a session exactly. The core is
+  *  deterministic given the ROM, the RNG seed, the quirk profile, the
+  *  instructions per frame and the key state at every instruction, so only
+  *  key changes are stored, each at the frame and instruction it landed on.
+  *
+  *  Text format, one item per line:
+  *      chip8-movie 2
+  *      seed <decimal>
+  *      ipf <decimal>
+  *      quirks <profile name>               (optional, absent = modern)
+  *      <frame>[:<cycle>] <key mask, hex>   (repeated, ascending)
+  *      end <frames recorded>
+  *
+  *  Bit i of a key mask is CHIP-8 key i. A mask applies from cycle
+  *  instructions into its frame on, or from the start of the frame without
+  *  one. Version 1 movies, which change keys only at frame starts, load as is.
+  */
+ class Movie {
+    public:
+        struct Event {
+            uint64_t frame;
+            uint16_t keys;
+            uint32_t cycle;         //Instructions into the frame
+        };
+
+        uint64_t seed = 0;
+        uint32_t ipf = 0;
+        Chip8Quirks quirks = QUIRKS_MODERN;
+        uint64_t length = 0;        //Frames covered
+        std::vector<Event> events;
+
+        void record(uint64_t frame, uint16_t keys, uint32_t cycle = 0);    //Stored only if the mask changed
+        void truncate(uint64_t frame);                  //Forget frame and everything after it (rewind)
+        //The changes to pass runFrame() for frame. cursor starts at 0, frames ascending;
+        //changes from frames that were skipped land at the start of this one.
+        void changesAt(uint64_t frame, size_t& cursor, std::vector<Chip8KeyEvent>& changes) const;
+        bool save(const char* path) const;
+        bool load(const char* path);
+ };
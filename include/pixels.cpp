@@ -0,0 +1,58 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "pixels.h"
+ #include <cstring>
+
+ #if defined(__SSE2__) || defined(_M_X64)
+ #include <emmintrin.h>
+ #define PIXELS_SSE2
+ #endif
+
+ //One display row to 64 pixels
+ static void expandRow(uint64_t row, uint32_t* out, uint32_t fg, uint32_t bg) {
+ #ifdef PIXELS_SSE2
+     //Four pixels per step: broadcast a nibble, compare each lane against its
+     //bit, then select fg/bg as bg ^ ((fg ^ bg) & mask)
+     const __m128i bits = _mm_set_epi32(1, 2, 4, 8);
+     const __m128i bgv = _mm_set1_epi32(bg);
+     const __m128i diff = _mm_set1_epi32(fg ^ bg);
+     for(int i = 0; i < 16; ++i) {
+         __m128i nibble = _mm_set1_epi32((int)(row >> (60 - 4 * i)) & 0xF);
+         __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(nibble, bits), bits);
+         __m128i px = _mm_xor_si128(bgv, _mm_and_si128(diff, mask));
+         _mm_storeu_si128((__m128i*)(out + 4 * i), px);
+     }
+ #else
+     uint32_t diff = fg ^ bg;
+     for(int x = 0; x < 64; ++x) {
+         out[x] = bg ^ (diff & (0u - (uint32_t)((row >> (63 - x)) & 1)));
+     }
+ #endif
+ }
+
+ void expandRows(const uint64_t* rows, int first, int count, uint32_t* out, int pitch,
+                 uint32_t fg, uint32_t bg, int scale) {
+     if(scale <= 1) {
+         for(int y = 0; y < count; ++y) {
+             expandRow(rows[first + y], out + y * pitch, fg, bg);
+         }
+         return;
+     }
+
+     uint32_t line[64];
+     for(int y = 0; y < count; ++y) {
+         expandRow(rows[first + y], line, fg, bg);
+         uint32_t* dst = out + y * scale * pitch;
+         for(int x = 0; x < 64; ++x) {
+             for(int s = 0; s < scale; ++s) {
+                 dst[x * scale + s] = line[x];
+             }
+         }
+         for(int s = 1; s < scale; ++s) {
+             memcpy(dst + s * pitch, dst, 64 * scale * sizeof(uint32_t));
+         }
+     }
+ }
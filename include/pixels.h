@@ -0,0 +1,18 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstdint>
+
+ /*
+  *  Expands packed display rows (bit 63 = leftmost pixel) into 32-bit
+  *  pixels. Each bit becomes fg or bg; scale > 1 repeats every pixel
+  *  scale times across and every line scale times down.
+  *
+  *  out points at the first pixel of row `first`; pitch is the distance
+  *  between output lines in pixels.
+  */
+ void expandRows(const uint64_t* rows, int first, int count, uint32_t* out, int pitch,
+                 uint32_t fg, uint32_t bg, int scale = 1);
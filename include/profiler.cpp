@@ -0,0 +1,159 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "profiler.h"
+ #include "disasm.h"
+ #include <algorithm>
+ #include <vector>
+
+ struct BlockInfo {
+     uint16_t start;
+     uint16_t end;           //Address of the last instruction
+     uint64_t entries;
+     uint64_t instructions;
+ };
+
+ struct LoopInfo {
+     uint16_t head;
+     uint16_t tail;          //The backward jump
+     uint64_t iterations;
+     uint64_t instructions;
+ };
+
+ Profiler::Profiler() {
+     clear();
+ }
+
+ void Profiler::clear() {
+     for(int i = 0; i < 0x1000; ++i) {
+         counts[i] = 0;
+     }
+ }
+
+ void Profiler::hitBlock(uint16_t pc, int instructions) {
+     for(int i = 0; i < instructions; ++i) {
+         ++counts[(pc + 2 * i) & 0xFFF];
+     }
+ }
+
+ static uint16_t opcodeAt(const uint8_t memory[0x1000], int addr) {
+     return memory[addr & 0xFFF] << 8 | memory[(addr + 1) & 0xFFF];
+ }
+
+ void Profiler::report(FILE* out, const uint8_t memory[0x1000], int topN) const {
+     uint64_t total = 0;
+     bool leader[0x1000] = {false};
+     for(int a = 0; a < 0x1000; ++a) {
+         total += counts[a];
+     }
+     if(total == 0) {
+         fprintf(out, "No instructions recorded\n");
+         return;
+     }
+
+     //Leaders come from control flow alone: an executed address starts a
+     //block if it is a jump or call target, follows a control transfer (a
+     //skip's fall-through or a call's return point), or is reached some way
+     //the code does not show, such as Bnnn or the entry at 0x200
+     for(int a = 0; a < 0x1000; ++a) {
+         if(counts[a] == 0) {
+             continue;
+         }
+         int prev = (a - 2) & 0xFFF;
+         FlowKind prevFlow = flowKind(opcodeAt(memory, prev));
+         if(counts[prev] == 0 || (prevFlow != FLOW_NONE && prevFlow != FLOW_WAIT)) {
+             leader[a] = true;
+         }
+         uint16_t op = opcodeAt(memory, a);
+         FlowKind flow = flowKind(op);
+         if(flow == FLOW_JUMP || flow == FLOW_CALL) {
+             leader[op & 0xFFF] = counts[op & 0xFFF] > 0;
+         }
+         if(flow == FLOW_SKIP) {
+             leader[(a + 4) & 0xFFF] = counts[(a + 4) & 0xFFF] > 0;
+         }
+     }
+
+     std::vector<BlockInfo> blocks;
+     for(int a = 0; a < 0x1000; ++a) {
+         if(!leader[a]) {
+             continue;
+         }
+         BlockInfo block = {(uint16_t)a, (uint16_t)a, counts[a], 0};
+         int b = a;
+         while(true) {
+             block.instructions += counts[b];
+             block.end = b;
+             FlowKind flow = flowKind(opcodeAt(memory, b));
+             int next = b + 2;
+             if(next >= 0x1000 || counts[next] == 0 || leader[next] || (flow != FLOW_NONE && flow != FLOW_WAIT)) {
+                 break;
+             }
+             b = next;
+         }
+         blocks.push_back(block);
+     }
+
+     std::vector<LoopInfo> loops;
+     for(int a = 0; a < 0x1000; ++a) {
+         uint16_t op = opcodeAt(memory, a);
+         if(counts[a] == 0 || flowKind(op) != FLOW_JUMP || (op & 0xFFF) > a) {
+             continue;
+         }
+         LoopInfo loop = {(uint16_t)(op & 0xFFF), (uint16_t)a, counts[a], 0};
+         for(int b = loop.head; b <= a; ++b) {
+             loop.instructions += counts[b];
+         }
+         loops.push_back(loop);
+     }
+
+     fprintf(out, "Instructions: %llu\n", (unsigned long long)total);
+
+     std::sort(blocks.begin(), blocks.end(), [](const BlockInfo& l, const BlockInfo& r) {
+         return l.instructions > r.instructions;
+     });
+     fprintf(out, "\nHottest basic blocks\n");
+     fprintf(out, "  start  end   entries       instructions   share\n");
+     for(int i = 0; i < (int)blocks.size() && i < topN; ++i) {
+         fprintf(out, "  %03X    %03X   %-12llu  %-12llu  %6.2f%%\n", blocks[i].start, blocks[i].end,
+                 (unsigned long long)blocks[i].entries, (unsigned long long)blocks[i].instructions,
+                 100.0 * blocks[i].instructions / total);
+     }
+
+     std::sort(loops.begin(), loops.end(), [](const LoopInfo& l, const LoopInfo& r) {
+         return l.instructions > r.instructions;
+     });
+     fprintf(out, "\nHottest loops (backward jumps)\n");
+     fprintf(out, "  head   tail  iterations    instructions   share\n");
+     for(int i = 0; i < (int)loops.size() && i < topN; ++i) {
+         fprintf(out, "  %03X    %03X   %-12llu  %-12llu  %6.2f%%\n", loops[i].head, loops[i].tail,
+                 (unsigned long long)loops[i].iterations, (unsigned long long)loops[i].instructions,
+                 100.0 * loops[i].instructions / total);
+     }
+
+     fprintf(out, "\nExecuted code\n");
+     for(int a = 0; a < 0x1000; ++a) {
+         if(counts[a] == 0) {
+             continue;
+         }
+         if(leader[a]) {
+             fprintf(out, "\n");
+         }
+         uint16_t op = opcodeAt(memory, a);
+         fprintf(out, "  %03X  %04X  %-16s %12llu  %6.2f%%\n", a, op, disassemble(op).c_str(),
+                 (unsigned long long)counts[a], 100.0 * counts[a] / total);
+     }
+ }
+
+ bool Profiler::report(const char* path, const uint8_t memory[0x1000], int topN) const {
+     FILE* out = fopen(path, "w");
+     if(out == NULL) {
+         printf("Error: Failed to write %s\n", path);
+         return false;
+     }
+     report(out, memory, topN);
+     fclose(out);
+     return true;
+ }
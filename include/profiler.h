@@ -0,0 +1,30 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstdint>
+ #include <cstdio>
+
+ /*
+  *  Execution counts per address over the 4 KB address space. Recording is
+  *  one increment per instruction, cheap enough for long soak runs. The
+  *  report splits the code that ran into basic blocks and loops by its
+  *  control flow, attributes the counts to them, and prints an annotated
+  *  disassembly of everything that ran.
+  */
+ class Profiler {
+    public:
+        Profiler();
+        void hit(uint16_t pc) {++counts[pc & 0xFFF];}
+        void hitBlock(uint16_t pc, int instructions);  //Straight-line run starting at pc
+        uint64_t count(uint16_t pc) const {return counts[pc & 0xFFF];}
+        void clear();
+
+        void report(FILE* out, const uint8_t memory[0x1000], int topN = 20) const;
+        bool report(const char* path, const uint8_t memory[0x1000], int topN = 20) const;
+
+    private:
+        uint64_t counts[0x1000];
+ };
@@ -0,0 +1,118 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "rewind.h"
+ #include <cstring>
+
+ //Packed delta: repeated (uint16 zero run, uint16 literal length, literal bytes)
+ static const size_t SNAPSHOT_SIZE = sizeof(Chip8State);
+ static const size_t MAX_RUN = 0xFFFF;
+
+ RewindBuffer::RewindBuffer(size_t maxFrames, size_t maxBytes)
+     : deltas(maxFrames), data(maxBytes), scratch(SNAPSHOT_SIZE * 3 + 4) {
+     clear();
+ }
+
+ void RewindBuffer::clear() {
+     first = 0;
+     count = 0;
+     used = 0;
+     haveNewest = false;
+ }
+
+ static void put16(uint8_t*& out, size_t v) {
+     *out++ = v & 0xFF;
+     *out++ = v >> 8;
+ }
+
+ void RewindBuffer::push(const Chip8State& snapshot) {
+     if(!haveNewest) {
+         newest = snapshot;
+         haveNewest = true;
+         return;
+     }
+
+     //Encode newest ^ snapshot: applying it to snapshot gives newest back
+     const uint8_t* a = (const uint8_t*)&newest;
+     const uint8_t* b = (const uint8_t*)&snapshot;
+     uint8_t* out = scratch.data();
+     size_t pos = 0;
+     while(pos < SNAPSHOT_SIZE) {
+         size_t zeros = 0;
+         while(pos < SNAPSHOT_SIZE && a[pos] == b[pos] && zeros < MAX_RUN) {
+             ++pos;
+             ++zeros;
+         }
+         size_t start = pos;
+         while(pos < SNAPSHOT_SIZE && a[pos] != b[pos] && pos - start < MAX_RUN) {
+             ++pos;
+         }
+         put16(out, zeros);
+         put16(out, pos - start);
+         for(size_t i = start; i < pos; ++i) {
+             *out++ = a[i] ^ b[i];
+         }
+     }
+     store(scratch.data(), out - scratch.data());
+     newest = snapshot;
+ }
+
+ void RewindBuffer::store(const uint8_t* bytes, uint32_t length) {
+     if(length > data.size() || deltas.empty()) {
+         count = 0;
+         used = 0;
+         return;
+     }
+     //Make room by forgetting the oldest frames
+     while(count == deltas.size() || used + length > data.size()) {
+         used -= deltas[first].length;
+         first = (first + 1) % deltas.size();
+         --count;
+     }
+
+     size_t offset = count == 0 ? 0 : (deltas[first].offset + used) % data.size();
+     size_t head = data.size() - offset < length ? data.size() - offset : length;
+     memcpy(&data[offset], bytes, head);
+     memcpy(&data[0], bytes + head, length - head);
+
+     Delta& delta = deltas[(first + count) % deltas.size()];
+     delta.offset = offset;
+     delta.length = length;
+     ++count;
+     used += length;
+ }
+
+ void RewindBuffer::load(const Delta& delta, uint8_t* out) const {
+     size_t head = data.size() - delta.offset < delta.length ? data.size() - delta.offset : delta.length;
+     memcpy(out, &data[delta.offset], head);
+     memcpy(out + head, &data[0], delta.length - head);
+ }
+
+ bool RewindBuffer::rewind(Chip8State& snapshot) {
+     if(count == 0) {
+         return false;
+     }
+     const Delta& delta = deltas[(first + count - 1) % deltas.size()];
+     load(delta, scratch.data());
+
+     uint8_t* state = (uint8_t*)&newest;
+     const uint8_t* in = scratch.data();
+     const uint8_t* end = in + delta.length;
+     size_t pos = 0;
+     while(in < end) {
+         size_t zeros = in[0] | in[1] << 8;
+         size_t literal = in[2] | in[3] << 8;
+         in += 4;
+         pos += zeros;
+         for(size_t i = 0; i < literal; ++i) {
+             state[pos++] ^= *in++;
+         }
+     }
+
+     used -= delta.length;
+     --count;
+     snapshot = newest;
+     return true;
+ }
@@ -0,0 +1,46 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include "core.h"
+ #include <cstdint>
+ #include <vector>
+
+ /*
+  *  Per-frame history for rewinding. Only the newest snapshot is kept whole;
+  *  every older frame is stored as the XOR of it and the frame after it,
+  *  run-length packed. Between two frames almost nothing but a few registers,
+  *  timers and some screen rows changes, so a frame typically costs tens of
+  *  bytes. Both the frame count and the bytes used are capped; the oldest
+  *  frames are dropped first. All storage is allocated up front, so pushing
+  *  and rewinding never allocate.
+  */
+ class RewindBuffer {
+    public:
+        RewindBuffer(size_t maxFrames = 60 * 60 * 5, size_t maxBytes = 16 << 20);
+        void push(const Chip8State& snapshot);
+        bool rewind(Chip8State& snapshot);   //Steps one frame back, false once history runs out
+        size_t frames() const {return count;}
+        size_t bytesUsed() const {return used;}
+        void clear();
+
+    private:
+        struct Delta {
+            size_t offset;      //Into data, may wrap
+            uint32_t length;
+        };
+
+        std::vector<Delta> deltas;      //Ring, newest at (first + count - 1)
+        size_t first;
+        size_t count;
+        std::vector<uint8_t> data;      //Ring of packed deltas
+        size_t used;
+        Chip8State newest;
+        bool haveNewest;
+        std::vector<uint8_t> scratch;
+
+        void store(const uint8_t* bytes, uint32_t length);
+        void load(const Delta& delta, uint8_t* out) const;
+ };
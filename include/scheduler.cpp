@@ -0,0 +1,55 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "scheduler.h"
+ #include <thread>
+
+ //Sleep until this close to the deadline, then yield the rest of the way.
+ //OS sleeps can overshoot by a scheduler tick, which would cost a whole frame.
+ const std::chrono::microseconds spinMargin(500);
+
+ FrameScheduler::FrameScheduler(uint32_t instructionsPerFrame, double speed) {
+     ipf = instructionsPerFrame;
+     fastForward = false;
+     setSpeed(speed);
+     deadline = Clock::now() + framePeriod;
+ }
+
+ void FrameScheduler::setFrameRate(double hz) {
+     if(hz <= 0) {
+         hz = 60.0;
+     }
+     framePeriod = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / hz));
+ }
+
+ int FrameScheduler::millisecondsLeft() const {
+     if(fastForward) {
+         return 0;
+     }
+     Clock::duration left = deadline - Clock::now();
+     return left.count() > 0 ? std::chrono::duration_cast<std::chrono::milliseconds>(left).count() : 0;
+ }
+
+ void FrameScheduler::waitForNextFrame() {
+     Clock::time_point now = Clock::now();
+     if(fastForward) {
+         deadline = now + framePeriod;
+         return;
+     }
+
+     if(now < deadline - spinMargin) {
+         std::this_thread::sleep_until(deadline - spinMargin);
+     }
+     while(Clock::now() < deadline) {
+         std::this_thread::yield();
+     }
+
+     //If we fell more than a few frames behind, resync instead of racing to catch up
+     deadline += framePeriod;
+     now = Clock::now();
+     if(now > deadline + 4 * framePeriod) {
+         deadline = now + framePeriod;
+     }
+ }
@@ -0,0 +1,37 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <chrono>
+ #include <cstdint>
+
+ //Instructions per 60 Hz frame, about 600 instructions per second
+ const uint32_t DEFAULT_IPF = 10;
+
+ /*
+  *  Paces the emulator in 60 Hz frames. The front end runs a whole batch of
+  *  instructions per frame, then sleeps until the next frame deadline.
+  *  speed scales the frame rate (2.0 runs the game twice as fast, timers
+  *  included); fast-forward stops sleeping altogether.
+  */
+ class FrameScheduler {
+    public:
+        FrameScheduler(uint32_t instructionsPerFrame = DEFAULT_IPF, double speed = 1.0);
+        uint32_t instructionsPerFrame() const {return ipf;}
+        void setSpeed(double multiplier) {setFrameRate(60.0 * multiplier);}
+        void setFrameRate(double hz);
+        void setFastForward(bool enabled) {fastForward = enabled;}
+        void waitForNextFrame();
+        int millisecondsLeft() const;       //Until the next frame is due, 0 if it already is
+        void resync() {deadline = Clock::now() + framePeriod;}  //After an idle stretch
+
+    private:
+        typedef std::chrono::steady_clock Clock;
+
+        uint32_t ipf;
+        bool fastForward;
+        Clock::duration framePeriod;
+        Clock::time_point deadline;
+ };
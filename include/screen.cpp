@@ -4,11 +4,21 @@
  */
 
  #include "screen.h"
+ #include "pixels.h"
+ #include <cstring>
 
- Screen::Screen(SDL_Window* w, SDL_Surface* s, SDL_Surface* f) {
-     window = w;
-     surface = s;
-     frameBuffer = f;
+ Screen::Screen(int scale, uint32_t fg, uint32_t bg) {
+     window = NULL;
+     renderer = NULL;
+     texture = NULL;
+     scaling = scale;
+     fgColor = 0xFF000000 | fg;
+     bgColor = 0xFF000000 | bg;
+     for(int i = 0; i < 32; ++i) {
+         shownRows[i] = 0;
+     }
+     redraw = true;
+     memset(keyOfScancode, -1, sizeof(keyOfScancode));
  }
 
  void Screen::init() {
@@ -16,65 +26,148 @@
          printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
      }
      else {
+         //Key events are looked up by scancode. The layout is given as keycodes,
+         //which depend on the keyboard layout, so they are resolved once SDL is up.
+         for(int i = 0; i < 16; ++i) {
+             SDL_Scancode code = SDL_GetScancodeFromKey(layout[i]);
+             if(code != SDL_SCANCODE_UNKNOWN) {
+                 keyOfScancode[code] = i;
+             }
+         }
          window = SDL_CreateWindow("Chip-8 Emulator", SDL_WINDOWPOS_UNDEFINED,
-                                 SDL_WINDOWPOS_UNDEFINED, 64 * SCALING,
-                                 32 * SCALING, SDL_WINDOW_SHOWN);
+                                 SDL_WINDOWPOS_UNDEFINED, 64 * scaling,
+                                 32 * scaling, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
          if (window == NULL) {
              printf("Window could not be created! SDL_Error: %s\n", SDL_GetError());
+             return;
+         }
+         renderer = SDL_CreateRenderer(window, -1, 0);
+         if (renderer == NULL) {
+             printf("Renderer could not be created! SDL_Error: %s\n", SDL_GetError());
+             return;
          }
-         else {
-             surface = SDL_GetWindowSurface(window);
-             frameBuffer = SDL_GetWindowSurface(window);
+         //Keep pixels square and sharp at any window or DPI scale
+         SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+         SDL_RenderSetLogicalSize(renderer, 64, 32);
+         texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+                                     SDL_TEXTUREACCESS_STREAMING, 64, 32);
+         if (texture == NULL) {
+             printf("Texture could not be created! SDL_Error: %s\n", SDL_GetError());
          }
      }
  }
 
- void Screen::draw(uint8_t screenBuffer[32][64]) {
-     SDL_FillRect(frameBuffer, NULL, BG);
-     SDL_Rect pixel;
+ void Screen::draw(const uint64_t screenBuffer[32]) {
+     if(texture == NULL) {
+         return;
+     }
+     //Only the band of rows that differs from what is on screen gets uploaded
+     int first = 32;
+     int last = -1;
      for(int y = 0; y < 32; ++y) {
-         for(int x = 0; x < 64; ++x) {
-             if(screenBuffer[y][x] == 1) {
-                 pixel.x = x * SCALING;
-                 pixel.y = y * SCALING;
-                 pixel.w = pixel.h = SCALING;
-                 SDL_FillRect(frameBuffer, &pixel, FG);
+         if(screenBuffer[y] != shownRows[y]) {
+             if(first == 32) {
+                 first = y;
              }
+             last = y;
+             shownRows[y] = screenBuffer[y];
          }
      }
-     SDL_BlitSurface(frameBuffer, NULL, surface, NULL);
-     SDL_UpdateWindowSurface(window);
+     if(redraw) {
+         first = 0;
+         last = 31;
+     }
+     if(last < 0) {
+         return;
+     }
+
+     //Expand straight into the texture: one upload, scaling is left to the GPU
+     SDL_Rect band = {0, first, 64, last - first + 1};
+     void* pixels;
+     int pitch;
+     if(SDL_LockTexture(texture, &band, &pixels, &pitch) != 0) {
+         return;
+     }
+     expandRows(screenBuffer, first, band.h, (uint32_t*)pixels, pitch / 4, fgColor, bgColor);
+     SDL_UnlockTexture(texture);
+     redraw = false;
+
+     SDL_RenderClear(renderer);
+     SDL_RenderCopy(renderer, texture, NULL, NULL);
+     SDL_RenderPresent(renderer);
  }
 
- void Screen::handleInput(int chip8keyboard[16]){
+ bool Screen::handleInput(int waitMs){
+     //Block in the event queue when asked to, instead of polling
+     if(waitMs > 0 && SDL_WaitEventTimeout(&e, waitMs)) {
+         if(!handleEvent()) {
+             return false;
+         }
+     }
      while(SDL_PollEvent(&e)) {
-         if(e.type == SDL_QUIT) {
-             exit(0);
+         if(!handleEvent()) {
+             return false;
          }
-         if(e.type == SDL_KEYDOWN) {
-             if(e.key.keysym.sym == SDLK_ESCAPE) {
-                 exit(0);
-             }
-             for(int i = 0; i < 16; ++i) {
-                 if(e.key.keysym.sym == keys[i]) {
-                     chip8keyboard[i] = 1;
-                 }
-             }
+     }
+     return true;
+ }
 
+ bool Screen::handleEvent() {
+     if(e.type == SDL_QUIT) {
+         return false;
+     }
+     if(e.type == SDL_WINDOWEVENT) {
+         redraw = true;
+     }
+     if(e.type == SDL_KEYDOWN) {
+         if(e.key.keysym.sym == SDLK_ESCAPE) {
+             return false;
          }
-         if(e.type == SDL_KEYUP) {
-             for(int i = 0; i < 16; ++i) {
-                 if(e.key.keysym.sym == keys[i]) {
-                     chip8keyboard[i] = 0;
-                 }
-             }
-
+         if(e.key.keysym.sym == SDLK_TAB) {
+             fastForward = true;
+         }
+         if(e.key.keysym.sym == SDLK_BACKSPACE) {
+             rewinding = true;
+         }
+         setKey(keyOfScancode[e.key.keysym.scancode], true);
+     }
+     if(e.type == SDL_KEYUP) {
+         if(e.key.keysym.sym == SDLK_TAB) {
+             fastForward = false;
+         }
+         if(e.key.keysym.sym == SDLK_BACKSPACE) {
+             rewinding = false;
          }
+         setKey(keyOfScancode[e.key.keysym.scancode], false);
+     }
+     return true;
+ }
+
+ void Screen::setKey(int key, bool down) {
+     if(key < 0) {
+         return;
+     }
+     //Auto-repeats change nothing, so they queue nothing
+     uint16_t was = keys.load(std::memory_order_relaxed);
+     uint16_t held = down ? was | 1 << key : was & ~(1 << key);
+     if(held != was) {
+         keys.store(held, std::memory_order_relaxed);
+         //A full queue means the consumer has stopped draining; the change is dropped
+         changes.push({std::chrono::steady_clock::now(), held});
+     }
+ }
+
+ int Screen::refreshRate() {
+     SDL_DisplayMode mode;
+     if(SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window), &mode) != 0 || mode.refresh_rate <= 0) {
+         return 60;
      }
+     return mode.refresh_rate;
  }
 
  void Screen::close() {
-     SDL_FreeSurface(frameBuffer);
+     SDL_DestroyTexture(texture);
+     SDL_DestroyRenderer(renderer);
      SDL_DestroyWindow(window);
      SDL_Quit();
  }
@@ -3,25 +3,48 @@
  * 2022
  */
 
+ #pragma once
  #include <SDL2/SDL.h>
+ #include <atomic>
+ #include <chrono>
+ #include <cstdint>
  #include <cstdio>
+ #include "spscqueue.h"
+
+ //The CHIP-8 keys held after a key event, stamped when the event was handled
+ struct KeyChange {
+     std::chrono::steady_clock::time_point time;
+     uint16_t keys;              //Bit i = key i held
+ };
+ typedef SpscQueue<KeyChange, 256> KeyChangeQueue;
 
  class Screen {
     public:
-        Screen(SDL_Window* w = NULL, SDL_Surface* s = NULL, SDL_Surface* f = NULL);
+        Screen(int scale = 8, uint32_t fg = 0xFFFFFF, uint32_t bg = 0x0);
         void init();
-        void draw(uint8_t screenBuffer[32][64]);
-        void handleInput(int chip8keyboard[16]);
+        void draw(const uint64_t screenBuffer[32]);    //Presents only if something changed
+        bool handleInput(int waitMs = 0);  //false once the user asked to quit
+        KeyChangeQueue& keyChanges() {return changes;}  //Every change to keys, in order, for one consumer
+        int refreshRate();
         void close();
+        std::atomic<uint16_t> keys{0};     //CHIP-8 keys held, bit i = key i; readable from any thread
+        bool fastForward = false;   //Tab held
+        bool rewinding = false;     //Backspace held
     private:
         SDL_Window* window;
-        SDL_Surface* surface;
-        SDL_Surface* frameBuffer;
+        SDL_Renderer* renderer;
+        SDL_Texture* texture;       //64x32 ARGB, scaled to the window by the renderer
         SDL_Event e;
-        const int SCALING = 8;
-        const uint32_t BG = 0x0;
-        const uint32_t FG = 0xFFFFFF;
-        int keys[16] = {
+        bool handleEvent();
+        void setKey(int key, bool down);
+        int scaling;
+        uint32_t fgColor;
+        uint32_t bgColor;
+        uint64_t shownRows[32];     //What the window currently shows
+        bool redraw;                //Window was exposed/resized, present even if unchanged
+        KeyChangeQueue changes;
+        int8_t keyOfScancode[SDL_NUM_SCANCODES];    //CHIP-8 key for each physical key, -1 for none
+        SDL_Keycode layout[16] = {
             SDLK_x, SDLK_1, SDLK_2, SDLK_3,
             SDLK_q, SDLK_w, SDLK_e, SDLK_a,
             SDLK_s, SDLK_d, SDLK_z, SDLK_c,
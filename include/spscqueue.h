@@ -0,0 +1,51 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <atomic>
+ #include <cstddef>
+
+ /*
+  *  Single-producer, single-consumer ring of N values (N a power of two).
+  *
+  *  Unlike TripleBuffer every value is delivered, in order. Each side only
+  *  writes its own index, so push() and pop() are a load, a copy and a
+  *  release store: no locks, no waiting, safe to call from an audio
+  *  callback. A full queue refuses the push rather than overwrite.
+  */
+ template <typename T, size_t N>
+ class SpscQueue {
+    public:
+        bool push(const T& value) {     //Producer only; false if full
+            size_t tail = tailIndex.load(std::memory_order_relaxed);
+            if(tail - headIndex.load(std::memory_order_acquire) == N) {
+                return false;
+            }
+            slots[tail & (N - 1)] = value;
+            tailIndex.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T& value) {            //Consumer only; false if empty
+            size_t head = headIndex.load(std::memory_order_relaxed);
+            if(head == tailIndex.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = slots[head & (N - 1)];
+            headIndex.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool empty() const {            //Consumer only
+            return headIndex.load(std::memory_order_relaxed) == tailIndex.load(std::memory_order_acquire);
+        }
+
+    private:
+        static_assert(N != 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+        T slots[N] = {};
+        alignas(64) std::atomic<size_t> headIndex{0};   //Next to pop, consumer writes
+        alignas(64) std::atomic<size_t> tailIndex{0};   //Next to push, producer writes
+ };
@@ -0,0 +1,59 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "stats.h"
+ #include <chrono>
+
+ uint64_t statsClockNs() {
+     return std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch()).count();
+ }
+
+ static double ratio(uint64_t part, uint64_t whole) {
+     return whole == 0 ? 0.0 : (double)part / whole;
+ }
+
+ void writeStatsJson(FILE* out, const Chip8Stats& stats, const PhaseTimes& times,
+                     uint64_t cycles, uint64_t frames) {
+     fprintf(out, "{\n");
+ #ifdef CHIP8_STATS
+     fprintf(out, "  \"enabled\": true,\n");
+ #else
+     fprintf(out, "  \"enabled\": false,\n");
+ #endif
+     fprintf(out, "  \"cycles\": %llu,\n", (unsigned long long)cycles);
+     fprintf(out, "  \"frames\": %llu,\n", (unsigned long long)frames);
+
+     fprintf(out, "  \"opcodeClass\": {");
+     for(int i = 0; i < 16; ++i) {
+         fprintf(out, "%s\"%X\": %llu", i == 0 ? "" : ", ", i, (unsigned long long)stats.opcodeClass[i]);
+     }
+     fprintf(out, "},\n");
+
+     fprintf(out, "  \"draws\": %llu,\n", (unsigned long long)stats.draws);
+     fprintf(out, "  \"drawCollisions\": %llu,\n", (unsigned long long)stats.drawCollisions);
+     fprintf(out, "  \"collisionRate\": %.4f,\n", ratio(stats.drawCollisions, stats.draws));
+     fprintf(out, "  \"skipsTested\": %llu,\n", (unsigned long long)stats.skipsTested);
+     fprintf(out, "  \"skipsTaken\": %llu,\n", (unsigned long long)stats.skipsTaken);
+     fprintf(out, "  \"skipTakenRatio\": %.4f,\n", ratio(stats.skipsTaken, stats.skipsTested));
+     fprintf(out, "  \"idleCycles\": %llu,\n", (unsigned long long)stats.idleCycles);
+
+     fprintf(out, "  \"timeNs\": {\"cpu\": %llu, \"render\": %llu, \"input\": %llu, \"sleep\": %llu}\n",
+             (unsigned long long)times.cpu.load(), (unsigned long long)times.render.load(),
+             (unsigned long long)times.input.load(), (unsigned long long)times.sleep.load());
+     fprintf(out, "}\n");
+ }
+
+ bool writeStatsJson(const char* path, const Chip8Stats& stats, const PhaseTimes& times,
+                     uint64_t cycles, uint64_t frames) {
+     FILE* out = fopen(path, "w");
+     if(out == NULL) {
+         printf("Error: Failed to write %s\n", path);
+         return false;
+     }
+     writeStatsJson(out, stats, times, cycles, frames);
+     fclose(out);
+     return true;
+ }
@@ -0,0 +1,43 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <atomic>
+ #include <cstdint>
+ #include <cstdio>
+
+ //Hot-path counters only exist in builds made with -DCHIP8_STATS
+ #ifdef CHIP8_STATS
+ #define STATS(statement) statement
+ #else
+ #define STATS(statement)
+ #endif
+
+ //Counted by the core
+ struct Chip8Stats {
+     uint64_t opcodeClass[16] = {};  //Executions by high nibble
+     uint64_t draws = 0;
+     uint64_t drawCollisions = 0;
+     uint64_t skipsTested = 0;       //3xkk, 4xkk, 5xy0, 9xy0, Ex9E, ExA1
+     uint64_t skipsTaken = 0;
+     uint64_t idleCycles = 0;        //Fast-forwarded through idle loops, not in opcodeClass
+ };
+
+ //Wall time per front-end phase, in nanoseconds. cpu and sleep are spent on
+ //the emulator thread, render and input on the main thread. Atomic so the
+ //exporter can read them from either thread.
+ struct PhaseTimes {
+     std::atomic<uint64_t> cpu{0};
+     std::atomic<uint64_t> render{0};
+     std::atomic<uint64_t> input{0};
+     std::atomic<uint64_t> sleep{0};
+ };
+
+ uint64_t statsClockNs();
+
+ void writeStatsJson(FILE* out, const Chip8Stats& stats, const PhaseTimes& times,
+                     uint64_t cycles, uint64_t frames);
+ bool writeStatsJson(const char* path, const Chip8Stats& stats, const PhaseTimes& times,
+                     uint64_t cycles, uint64_t frames);
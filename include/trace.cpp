@@ -0,0 +1,56 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "trace.h"
+ #include <cstdio>
+ #include <fcntl.h>
+ #include <unistd.h>
+
+ TraceRing::TraceRing(size_t capacity) {
+     size_t size = 1;
+     while(size < capacity) {
+         size <<= 1;
+     }
+     records.resize(size);
+     mask = size - 1;
+     head = 0;
+ }
+
+ static bool writeAll(int fd, const void* data, size_t length) {
+     const char* p = (const char*)data;
+     while(length > 0) {
+         ssize_t written = write(fd, p, length);
+         if(written <= 0) {
+             return false;
+         }
+         p += written;
+         length -= written;
+     }
+     return true;
+ }
+
+ bool TraceRing::dump(int fd) const {
+     size_t count = size();
+     TraceHeader header = {{'C', '8', 'T', 'R'}, TRACE_VERSION, (uint16_t)sizeof(TraceRecord), (uint32_t)count};
+     if(!writeAll(fd, &header, sizeof(header))) {
+         return false;
+     }
+     //Oldest record first: the tail of the array, then the front
+     size_t first = (head - count) & mask;
+     size_t tail = records.size() - first < count ? records.size() - first : count;
+     return writeAll(fd, &records[first], tail * sizeof(TraceRecord))
+         && writeAll(fd, &records[0], (count - tail) * sizeof(TraceRecord));
+ }
+
+ bool TraceRing::dump(const char* path) const {
+     int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+     if(fd < 0) {
+         printf("Error: Failed to write %s\n", path);
+         return false;
+     }
+     bool ok = dump(fd);
+     close(fd);
+     return ok;
+ }
@@ -0,0 +1,59 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <cstdint>
+ #include <cstddef>
+ #include <cstring>
+ #include <vector>
+
+ //One retired instruction, with the whole register file after it ran. An
+ //instruction can write any number of registers (Fx65 writes V0 to Vx,
+ //8xy6/8xyE write Vx and VF), so the file is stored rather than guessed
+ //at, and a dump rebuilds the exact register state at every step. cycle
+ //doubles as the timestamp.
+ struct TraceRecord {
+     uint64_t cycle;
+     uint16_t pc;
+     uint16_t opcode;
+     uint16_t I;
+     uint8_t V[16];
+ };
+
+ //File layout: TraceHeader, then count records oldest first, host byte order
+ struct TraceHeader {
+     char magic[4];          //"C8TR"
+     uint16_t version;
+     uint16_t recordSize;
+     uint32_t count;
+ };
+
+ const uint16_t TRACE_VERSION = 2;
+
+ /*
+  *  Fixed-size ring of the most recent instructions. Recording is a handful
+  *  of stores with no branches on the ring state, so it can stay on for
+  *  whole sessions and be dumped when something goes wrong.
+  */
+ class TraceRing {
+    public:
+        explicit TraceRing(size_t capacity = 1 << 16);  //Rounded up to a power of two
+        void record(uint64_t cycle, uint16_t pc, uint16_t opcode, uint16_t I, const uint8_t V[16]) {
+            TraceRecord& r = records[head++ & mask];
+            r.cycle = cycle;
+            r.pc = pc;
+            r.opcode = opcode;
+            r.I = I;
+            memcpy(r.V, V, sizeof(r.V));
+        }
+        size_t size() const {return head < records.size() ? head : records.size();}
+        bool dump(const char* path) const;
+        bool dump(int fd) const;    //Only write(), usable from a signal handler
+
+    private:
+        std::vector<TraceRecord> records;
+        size_t mask;
+        uint64_t head;
+ };
@@ -0,0 +1,46 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include <atomic>
+ #include <cstdint>
+
+ /*
+  *  Single-producer, single-consumer triple buffer.
+  *
+  *  The producer fills back() and publish()es it; the consumer calls update()
+  *  and reads front(). Each side owns one slot and the third is swapped
+  *  through a single atomic, so neither side ever waits on the other and the
+  *  consumer always sees the newest complete value. Unread values are
+  *  overwritten, never queued.
+  */
+ template <typename T>
+ class TripleBuffer {
+    public:
+        T& back() {return buffers[backIndex];}
+        const T& front() const {return buffers[frontIndex];}
+
+        void publish() {
+            backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        //Returns true if a newer value was taken since the last call
+        bool update() {
+            if((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+                return false;
+            }
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+    private:
+        static const uint8_t INDEX = 0x3;
+        static const uint8_t FRESH = 0x4;   //Middle slot holds a value the consumer has not taken
+
+        T buffers[3] = {};
+        std::atomic<uint8_t> middle{1};
+        uint8_t backIndex = 0;              //Producer only
+        uint8_t frontIndex = 2;             //Consumer only
+ };
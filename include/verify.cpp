@@ -0,0 +1,401 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #include "verify.h"
+ #include "chip8.h"
+ #include "lockstep.h"
+ #include "disasm.h"
+ #include <algorithm>
+ #include <atomic>
+ #include <cstring>
+ #include <memory>
+ #include <thread>
+
+ const char* verifyEngineName(VerifyEngine engine) {
+     switch(engine) {
+         case VERIFY_CORE:           return "core";
+         case VERIFY_INTERPRETER:    return "interpreter";
+         case VERIFY_JIT:            return "jit";
+         case VERIFY_AOT:            return "aot";
+         default:                    return "lockstep";
+     }
+ }
+
+ bool parseVerifyEngine(const char* name, VerifyEngine& engine) {
+     for(int e = 0; e < VERIFY_ENGINE_COUNT; ++e) {
+         if(strcmp(name, verifyEngineName((VerifyEngine)e)) == 0) {
+             engine = (VerifyEngine)e;
+             return true;
+         }
+     }
+     return false;
+ }
+
+ Chip8Verifier::Chip8Verifier(uint64_t checkInterval, int workerCount) {
+     interval = checkInterval > 0 ? checkInterval : 1;
+     workers = workerCount > 0 ? workerCount : std::thread::hardware_concurrency();
+     if(workers <= 0) {
+         workers = 1;
+     }
+ }
+
+ static inline uint64_t mix(uint64_t hash, uint64_t word) {
+     hash = (hash ^ word) * 0x100000001B3;
+     return hash ^ (hash >> 29);
+ }
+
+ uint64_t Chip8Verifier::hashState(const Chip8State& s) {
+     //Field by field, so padding never counts
+     uint64_t hash = Chip8Core::hashRows(s.screen);
+     for(int i = 0; i < 0x1000; i += 8) {
+         uint64_t word;
+         memcpy(&word, &s.memory[i], 8);
+         hash = mix(hash, word);
+     }
+     for(int i = 0; i < 16; i += 4) {
+         uint64_t word;
+         memcpy(&word, &s.stack[i], 8);
+         hash = mix(hash, word);
+     }
+     for(int i = 0; i < 16; i += 8) {
+         uint64_t word;
+         memcpy(&word, &s.V[i], 8);
+         hash = mix(hash, word);
+     }
+     hash = mix(hash, s.cycles);
+     hash = mix(hash, s.rngState);
+     hash = mix(hash, (uint64_t)s.pc | (uint64_t)s.I << 16 | (uint64_t)s.endOfRom << 32 | (uint64_t)s.keys << 48);
+     hash = mix(hash, (uint64_t)s.sp | (uint64_t)s.delayTimer << 8 | (uint64_t)s.soundTimer << 16
+                      | (uint64_t)s.keyRegister << 24 | (uint64_t)s.keyWait << 32
+                      | (uint64_t)s.fault << 40 | (uint64_t)s.quirks << 48);
+     return hash;
+ }
+
+ uint16_t Chip8Verifier::randomKeys(uint64_t seed, uint64_t frame) {
+     //Half the time nothing, mostly single keys otherwise, now and then a chord
+     uint64_t r = Chip8Core::seedRandom(seed * 0x9E3779B97F4A7C15 + (frame >> 3));
+     switch(r & 7) {
+         case 0: case 1: case 2: case 3:
+             return 0;
+         case 7:
+             return (uint16_t)(r >> 16);
+         default:
+             return 1 << ((r >> 8) & 0xF);
+     }
+ }
+
+ size_t Chip8Verifier::randomChanges(uint64_t seed, uint64_t frame, uint32_t ipf, Chip8KeyEvent changes[3]) {
+     uint16_t keys = randomKeys(seed, frame);
+     changes[0] = {0, keys};
+     //One frame in four also gets a tap that starts and ends inside it
+     uint64_t r = Chip8Core::seedRandom(seed * 0xD6E8FEB86659FD93 + frame);
+     if((r >> 62) != 0 || ipf < 2) {
+         return 1;
+     }
+     uint32_t down = 1 + (r >> 8) % (ipf - 1);
+     uint32_t up = down + 1 + (r >> 32) % (ipf - down);
+     changes[1] = {down, (uint16_t)(keys | 1 << ((r >> 4) & 0xF))};
+     changes[2] = {up, keys};
+     return 3;
+ }
+
+ //Chip8::runFrame() without the shortcuts: every instruction through step()
+ static void referenceFrame(Chip8State& s, const Chip8KeyEvent* changes, size_t count, uint32_t instructions, bool tick) {
+     uint64_t frameStart = s.cycles;
+     uint64_t frameEnd = s.cycles + instructions;
+     for(size_t next = 0; ; ++next) {
+         if(s.keyWait) {
+             Chip8Core::resumeOnKey(s);
+         }
+         uint64_t cycleLimit = next < count ? std::min(frameStart + changes[next].cycle, frameEnd) : frameEnd;
+         while(s.cycles < cycleLimit && !Chip8Core::endEmulation(s) && !s.keyWait && s.fault == FAULT_NONE) {
+             Chip8Core::step(s);
+         }
+         if(next == count) {
+             break;
+         }
+         s.keys = changes[next].keys;
+     }
+     if(tick) {
+         Chip8Core::tickTimers(s);
+     }
+ }
+
+ //Candidates: load a state, run frames with the key changes given, hand the state back
+
+ struct CoreCandidate {
+     Chip8State s;
+     void load(const Chip8State& snapshot) {s = snapshot;}
+     void store(Chip8State& snapshot) const {snapshot = s;}
+     void runFrame(const Chip8KeyEvent* changes, size_t count, uint32_t instructions) {
+         Chip8Core::runFrame(s, instructions, changes, count);
+     }
+ };
+
+ struct Chip8Candidate {
+     std::unique_ptr<Chip8> chip8;
+     Chip8Candidate(Chip8Quirks quirks, Chip8::Engine engine) : chip8(new Chip8(false, quirks, engine)) {
+         chip8->init();
+     }
+     void load(const Chip8State& snapshot) {chip8->loadState(snapshot);}
+     void store(Chip8State& snapshot) const {chip8->saveState(snapshot);}
+     void runFrame(const Chip8KeyEvent* changes, size_t count, uint32_t instructions) {
+         chip8->runFrame(instructions, changes, count);
+     }
+ };
+
+ //Lane 0 is checked. The other lanes run the same state from other RNG seeds and
+ //key presses, so they split from lane 0 and merge back and its masking is exercised.
+ //Frame-start keys go in per lane; the changes inside the frame reach every lane.
+ struct LockstepCandidate {
+     std::unique_ptr<Chip8Lockstep> batch;
+     uint64_t seed;
+     uint64_t frame;
+     LockstepCandidate(Chip8Quirks quirks, uint64_t noiseSeed) : batch(new Chip8Lockstep(quirks)) {
+         seed = noiseSeed;
+         frame = 0;
+     }
+     void load(const Chip8State& snapshot) {
+         batch->load(0, snapshot);
+         Chip8State copy = snapshot;
+         for(int lane = 1; lane < Chip8Lockstep::LANES; ++lane) {
+             copy.rngState = Chip8Core::seedRandom(seed + lane);
+             batch->load(lane, copy);
+         }
+         frame = 0;
+     }
+     void store(Chip8State& snapshot) const {batch->store(0, snapshot);}
+     void runFrame(const Chip8KeyEvent* changes, size_t count, uint32_t instructions) {
+         batch->setKeys(0, changes[0].keys);
+         for(int lane = 1; lane < Chip8Lockstep::LANES; ++lane) {
+             batch->setKeys(lane, Chip8Verifier::randomKeys(seed + lane, frame));
+         }
+         ++frame;
+         batch->runFrame(instructions, changes + 1, count - 1);
+     }
+ };
+
+ //Reruns from start, the last state both agreed on, to find the frame and instruction
+ //that split them. Leaves the result as it is if the split does not happen again.
+ template<class Candidate>
+ static void narrow(Candidate& candidate, const VerifyJob& job, Chip8State start, uint64_t frame,
+                    uint64_t seenAt, VerifyResult& result) {
+     Chip8State expected;
+     Chip8State actual;
+     Chip8KeyEvent changes[3];
+     size_t count = 0;
+     auto differs = [&](uint32_t instructions) {
+         expected = start;
+         referenceFrame(expected, changes, count, instructions, true);
+         candidate.load(start);
+         candidate.runFrame(changes, count, instructions);
+         candidate.store(actual);
+         return Chip8Verifier::hashState(expected) != Chip8Verifier::hashState(actual);
+     };
+
+     for(; frame < seenAt; ++frame) {
+         count = Chip8Verifier::randomChanges(job.seed, frame, job.ipf, changes);
+         if(differs(job.ipf)) {
+             break;
+         }
+         start = expected;
+     }
+     if(frame == seenAt) {
+         return;
+     }
+
+     //Bisect on the frame's budget. Assumes states that have split stay split,
+     //which holds unless a later instruction happens to overwrite the difference.
+     uint32_t match = 0;
+     uint32_t split = job.ipf;
+     while(split - match > 1) {
+         uint32_t mid = match + (split - match) / 2;
+         if(differs(mid)) {
+             split = mid;
+         }
+         else {
+             match = mid;
+         }
+     }
+     differs(split);
+
+     result.frame = frame;
+     result.instruction = split;
+     result.before = start;
+     referenceFrame(result.before, changes, count, split - 1, false);
+     result.keys = result.before.keys;
+     result.expected = expected;
+     result.actual = actual;
+ }
+
+ template<class Candidate>
+ static void verifySession(Candidate& candidate, const VerifyJob& job, uint64_t interval, VerifyResult& result) {
+     Chip8State ref;
+     Chip8Core::reset(ref, job.seed, job.quirks);
+     if(job.rom == NULL || !Chip8Core::loadRom(ref, job.rom->data(), job.rom->size())) {
+         result.outcome = VERIFY_LOAD_FAILED;
+         return;
+     }
+     candidate.load(ref);
+
+     Chip8State good = ref;      //Last state both agreed on
+     uint64_t goodFrame = 0;
+     uint64_t nextCheck = interval;
+     Chip8State actual;
+     bool done = false;
+     while(!done) {
+         Chip8KeyEvent changes[3];
+         size_t count = Chip8Verifier::randomChanges(job.seed, result.frames, job.ipf, changes);
+         referenceFrame(ref, changes, count, job.ipf, true);
+         candidate.runFrame(changes, count, job.ipf);
+         ++result.frames;
+         done = (job.frames != 0 && result.frames >= job.frames) || Chip8Core::endEmulation(ref) || ref.fault != FAULT_NONE;
+         if(ref.cycles < nextCheck && !done) {
+             continue;
+         }
+
+         nextCheck = ref.cycles + interval;
+         ++result.checks;
+         candidate.store(actual);
+         if(Chip8Verifier::hashState(actual) == Chip8Verifier::hashState(ref)) {
+             good = ref;
+             goodFrame = result.frames;
+             continue;
+         }
+
+         result.outcome = VERIFY_DIVERGED;
+         result.frame = result.frames - 1;
+         result.instruction = 0;
+         result.keys = changes[0].keys;
+         result.before = good;
+         result.expected = ref;
+         result.actual = actual;
+         narrow(candidate, job, good, goodFrame, result.frames, result);
+         break;
+     }
+     result.cycles = ref.cycles;
+     result.stateHash = Chip8Verifier::hashState(ref);
+ }
+
+ VerifyResult Chip8Verifier::verify(const VerifyJob& job) const {
+     VerifyResult result = {};
+     result.outcome = VERIFY_MATCHED;
+     switch(job.engine) {
+         case VERIFY_CORE: {
+             CoreCandidate candidate;
+             verifySession(candidate, job, interval, result);
+             break;
+         }
+         case VERIFY_LOCKSTEP: {
+             LockstepCandidate candidate(job.quirks, job.seed ^ 0x5DEECE66D);
+             verifySession(candidate, job, interval, result);
+             break;
+         }
+         default: {
+             Chip8::Engine engine = job.engine == VERIFY_JIT ? Chip8::JIT
+                                  : job.engine == VERIFY_AOT ? Chip8::AOT : Chip8::INTERPRETER;
+             Chip8Candidate candidate(job.quirks, engine);
+             verifySession(candidate, job, interval, result);
+             break;
+         }
+     }
+     return result;
+ }
+
+ std::vector<VerifyResult> Chip8Verifier::run(const std::vector<VerifyJob>& jobs) {
+     std::vector<VerifyResult> results(jobs.size());
+     std::atomic<size_t> next{0};
+
+     //Sessions run to completion; the longest ones set the wall time either way
+     auto worker = [&]() {
+         for(size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1)) {
+             results[i] = verify(jobs[i]);
+         }
+     };
+
+     std::vector<std::thread> threads;
+     for(int i = 1; i < workers; ++i) {
+         threads.emplace_back(worker);
+     }
+     worker();
+     for(std::thread& thread : threads) {
+         thread.join();
+     }
+     return results;
+ }
+
+ static void compare(const char* name, uint64_t expected, uint64_t actual) {
+     printf("  %c %-12s %-18llx %llx\n", expected != actual ? '*' : ' ', name,
+            (unsigned long long)expected, (unsigned long long)actual);
+ }
+
+ static void printRow(const char* name, uint64_t row) {
+     printf("      %-12s ", name);
+     for(int x = 63; x >= 0; --x) {
+         putchar((row >> x) & 1 ? '#' : '.');
+     }
+     printf("\n");
+ }
+
+ void Chip8Verifier::report(const VerifyResult& r) {
+     if(r.outcome != VERIFY_DIVERGED) {
+         return;
+     }
+     if(r.instruction == 0) {
+         printf("  Diverged by frame %llu, but not when rerun from the last matching state\n",
+                (unsigned long long)r.frame);
+     }
+     else {
+         uint16_t opcode = Chip8Core::fetch(r.before);
+         printf("  Diverged in frame %llu, instruction %u, keys %04x\n",
+                (unsigned long long)r.frame, r.instruction, r.keys);
+         printf("  %03X  %04X  %s\n", r.before.pc, opcode, disassemble(opcode).c_str());
+     }
+
+     const Chip8State& e = r.expected;
+     const Chip8State& a = r.actual;
+     printf("    %-12s %-18s %s\n", "", "reference", "candidate");
+     compare("pc", e.pc, a.pc);
+     compare("I", e.I, a.I);
+     char name[16];
+     for(int i = 0; i < 16; ++i) {
+         snprintf(name, sizeof(name), "V%X", i);
+         compare(name, e.V[i], a.V[i]);
+     }
+     compare("sp", e.sp, a.sp);
+     int depth = e.sp > a.sp ? e.sp : a.sp;
+     for(int i = 0; i < 16; ++i) {
+         if(i < depth || e.stack[i] != a.stack[i]) {
+             snprintf(name, sizeof(name), "stack[%d]", i);
+             compare(name, e.stack[i], a.stack[i]);
+         }
+     }
+     compare("delay timer", e.delayTimer, a.delayTimer);
+     compare("sound timer", e.soundTimer, a.soundTimer);
+     compare("cycles", e.cycles, a.cycles);
+     compare("rng", e.rngState, a.rngState);
+     compare("key wait", e.keyWait, a.keyWait);
+     compare("key register", e.keyRegister, a.keyRegister);
+     compare("fault", e.fault, a.fault);
+     compare("end of rom", e.endOfRom, a.endOfRom);
+
+     int differing = 0;
+     for(int i = 0; i < 0x1000; ++i) {
+         if(e.memory[i] != a.memory[i] && ++differing <= 16) {
+             snprintf(name, sizeof(name), "mem[%03X]", i);
+             compare(name, e.memory[i], a.memory[i]);
+         }
+     }
+     if(differing > 16) {
+         printf("    ...and %d more bytes\n", differing - 16);
+     }
+     for(int y = 0; y < 32; ++y) {
+         if(e.screen[y] != a.screen[y]) {
+             snprintf(name, sizeof(name), "row %d", y);
+             printRow(name, e.screen[y]);
+             printRow("", a.screen[y]);
+         }
+     }
+ }
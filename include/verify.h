@@ -0,0 +1,90 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+ #pragma once
+ #include "core.h"
+ #include <cstdint>
+ #include <vector>
+
+ //Engines that can be checked against the reference
+ enum VerifyEngine : uint8_t {
+     VERIFY_CORE,            //Chip8Core::runFrame(): per-profile dispatch and idle skipping
+     VERIFY_INTERPRETER,     //Chip8 and its decode cache
+     VERIFY_JIT,
+     VERIFY_AOT,             //Only useful with a translation of the ROM linked in
+     VERIFY_LOCKSTEP,        //Lane 0 of a Chip8Lockstep, with perturbed copies in the other lanes
+     VERIFY_ENGINE_COUNT
+ };
+
+ const char* verifyEngineName(VerifyEngine engine);
+ bool parseVerifyEngine(const char* name, VerifyEngine& engine);
+
+ //One session: a ROM run on the reference and one candidate with the same random input
+ struct VerifyJob {
+     const std::vector<uint8_t>* rom;
+     VerifyEngine engine = VERIFY_INTERPRETER;
+     uint64_t seed = 0;              //Seeds the RNG and the key presses
+     uint32_t ipf = 10;
+     uint64_t frames = 600;          //0 = until the ROM ends or faults
+     Chip8Quirks quirks = QUIRKS_MODERN;
+ };
+
+ enum VerifyOutcome {
+     VERIFY_MATCHED,
+     VERIFY_DIVERGED,
+     VERIFY_LOAD_FAILED
+ };
+
+ struct VerifyResult {
+     VerifyOutcome outcome;
+     uint64_t frames;            //Frames run before stopping
+     uint64_t cycles;            //Reference instructions retired
+     uint64_t checks;            //State hashes compared
+     uint64_t stateHash;         //Reference state where the session stopped
+
+     //Only for VERIFY_DIVERGED. instruction is 0 if the split did not
+     //happen again when the frame was rerun from the last matching state.
+     uint64_t frame;             //Frame the engines split in
+     uint32_t instruction;       //Instructions into that frame, up to and including the one that split them
+     uint16_t keys;              //Held at that instruction
+     Chip8State before;          //Both agree up to here; pc is on the instruction that split them
+     Chip8State expected;        //Reference, with the frame cut short after that instruction
+     Chip8State actual;          //Candidate, same
+ };
+
+ /*
+  *  Differential checker for the fast execution paths.
+  *
+  *  The reference is Chip8Core::step() one instruction at a time, with no
+  *  decode cache, idle skipping or native code. Each session runs the
+  *  reference and a candidate frame by frame on the same ROM, seed and key
+  *  presses, some of them landing partway through a frame, and compares
+  *  hashes of the whole machine state every interval instructions. Between
+  *  checks the only cost is running both engines.
+  *
+  *  On a mismatch the session goes back to the last state both agreed on
+  *  and reruns it a frame at a time to find the frame that split them, then
+  *  cuts that frame short, bisecting on its instruction budget, to find the
+  *  first instruction after which the two states differ. Both states are
+  *  kept for report().
+  *
+  *  Sessions share nothing, so run() hands them out to one worker per core.
+  */
+ class Chip8Verifier {
+    public:
+        explicit Chip8Verifier(uint64_t interval = 1000, int workers = 0);    //0 workers = one per core
+        std::vector<VerifyResult> run(const std::vector<VerifyJob>& jobs);
+        VerifyResult verify(const VerifyJob& job) const;    //One session on the calling thread
+        int workerCount() const {return workers;}
+
+        static uint64_t hashState(const Chip8State& s);     //Everything but dirtyRows, which engines track differently
+        static uint16_t randomKeys(uint64_t seed, uint64_t frame);  //Keys held from a frame's start, changing every 8 frames
+        static size_t randomChanges(uint64_t seed, uint64_t frame, uint32_t ipf, Chip8KeyEvent changes[3]);     //randomKeys() and sometimes a tap within the frame
+        static void report(const VerifyResult& result);     //Where a session diverged, with both states side by side
+
+    private:
+        uint64_t interval;
+        int workers;
+ };
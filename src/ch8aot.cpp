@@ -0,0 +1,370 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+//Ahead-of-time translator: walks a ROM's control flow from 0x200 and writes
+//each basic block out as a C++ function. Linked into a front end, the output
+//runs under the AOT engine (see aot.h); make aot builds chip8-aot this way.
+
+#include "core.h"
+#include "disasm.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Blocks only run when they fit in what is left of the frame, so long ones are split
+static const int MAX_BLOCK_LENGTH = 16;
+
+static void usage() {
+    std::cout << "Usage: ./ch8aot [--quirks modern|vip|chip48|schip] [path to ROM] [output .cpp]\n";
+}
+
+//Whether the interpreter has a handler for the opcode that moves on to the next instruction
+static bool validOpcode(uint16_t opcode) {
+    uint8_t n = opcode & 0xF;
+    uint8_t kk = opcode & 0xFF;
+    switch(opcode >> 12) {
+        case 0x0: return opcode == 0x00E0 || opcode == 0x00EE;
+        case 0x8: return n <= 7 || n == 0xE;
+        case 0xE: return kk == 0x9E || kk == 0xA1;
+        case 0xF:
+            return kk == 0x07 || kk == 0x0A || kk == 0x15 || kk == 0x18 || kk == 0x1E
+                   || kk == 0x29 || kk == 0x33 || kk == 0x55 || kk == 0x65;
+        default: return true;
+    }
+}
+
+//Whether a block can hold the instruction. Stores have to go through the
+//interpreter so the runtime sees code being overwritten, and Fx0A halts.
+static bool translatable(uint16_t opcode) {
+    uint8_t kk = opcode & 0xFF;
+    if((opcode & 0xF000) == 0xF000 && (kk == 0x33 || kk == 0x55 || kk == 0x0A)) {
+        return false;
+    }
+    return validOpcode(opcode);
+}
+
+//Whether the instruction is written out as C++ rather than handed to the core's handler
+static bool inlined(uint16_t opcode) {
+    uint8_t kk = opcode & 0xFF;
+    switch(opcode >> 12) {
+        case 0x0: case 0x2: case 0xC: case 0xD:
+            return false;
+        case 0x8: return (opcode & 0xF) <= 3;
+        case 0xF: return kk == 0x07 || kk == 0x15 || kk == 0x18 || kk == 0x1E;
+        default: return true;
+    }
+}
+
+class Translator {
+    public:
+        Translator(const std::vector<uint8_t>& rom, Chip8Quirks quirks);
+        void walk();
+        void write(FILE* out, const std::string& name);
+        int blockCount() const {return blocks.size();}
+        int reachedCount() const;
+        int translatedCount() const;
+
+    private:
+        struct Block {
+            uint16_t address;
+            uint16_t length;
+        };
+
+        std::vector<uint8_t> rom;
+        uint16_t end;               //First address past the ROM
+        Chip8Quirks profile;
+        Chip8QuirkSet quirks;
+        bool reached[0x1000];       //Some path starts an instruction here
+        bool leader[0x1000];        //A block has to start here
+        std::vector<Block> blocks;
+        std::vector<uint16_t> handled;  //Opcodes handed to the core, in op[] order
+
+        uint16_t fetch(uint16_t addr) const {
+            return rom[addr - 0x200] << 8 | rom[addr - 0x200 + 1];
+        }
+        bool inRom(uint32_t addr) const {return addr >= 0x200 && addr + 1 < end;}
+        void split();
+        void writeInstruction(FILE* out, uint16_t addr, uint16_t opcode);
+        int opIndex(uint16_t opcode);
+};
+
+Translator::Translator(const std::vector<uint8_t>& image, Chip8Quirks q) : rom(image) {
+    end = 0x200 + rom.size();
+    profile = q;
+    quirks = Chip8Core::quirkSet(q);
+    memset(reached, 0, sizeof(reached));
+    memset(leader, 0, sizeof(leader));
+}
+
+void Translator::walk() {
+    //Every successor the instruction can have; Bnnn targets are only known at run time
+    std::vector<uint16_t> work;
+    work.push_back(0x200);
+    leader[0x200] = true;
+    while(!work.empty()) {
+        uint16_t addr = work.back();
+        work.pop_back();
+        if(!inRom(addr) || reached[addr]) {
+            continue;
+        }
+        reached[addr] = true;
+
+        uint16_t opcode = fetch(addr);
+        uint16_t nnn = opcode & 0x0FFF;
+        std::vector<uint16_t> next;
+        switch(flowKind(opcode)) {
+            case FLOW_NONE:
+                if(validOpcode(opcode)) {
+                    next.push_back(addr + 2);
+                }
+                break;
+            case FLOW_JUMP:     next.push_back(nnn); break;
+            case FLOW_CALL:     next.push_back(nnn); next.push_back(addr + 2); break;
+            case FLOW_SKIP:     next.push_back(addr + 2); next.push_back(addr + 4); break;
+            case FLOW_WAIT:     next.push_back(addr + 2); break;
+            case FLOW_RETURN:
+            case FLOW_COMPUTED:
+                break;
+        }
+
+        //Anything reached other than by falling through a block starts one
+        bool fallsThrough = flowKind(opcode) == FLOW_NONE && translatable(opcode);
+        for(size_t i = 0; i < next.size(); ++i) {
+            if(next[i] < 0x1000) {
+                leader[next[i]] |= !fallsThrough;
+                work.push_back(next[i]);
+            }
+        }
+    }
+    split();
+}
+
+void Translator::split() {
+    for(uint32_t addr = 0x200; addr < end; ++addr) {
+        if(!leader[addr] || !reached[addr] || !translatable(fetch(addr))) {
+            continue;
+        }
+        Block block = {(uint16_t)addr, 0};
+        uint16_t pc = addr;
+        while(true) {
+            uint16_t opcode = fetch(pc);
+            ++block.length;
+            if(flowKind(opcode) != FLOW_NONE) {
+                break;
+            }
+            pc += 2;
+            if(!inRom(pc) || !reached[pc] || leader[pc] || !translatable(fetch(pc))) {
+                break;
+            }
+            if(block.length == MAX_BLOCK_LENGTH) {
+                leader[pc] = true;
+                break;
+            }
+        }
+        blocks.push_back(block);
+    }
+}
+
+int Translator::reachedCount() const {
+    int count = 0;
+    for(int i = 0; i < 0x1000; ++i) {
+        count += reached[i];
+    }
+    return count;
+}
+
+int Translator::translatedCount() const {
+    int count = 0;
+    for(size_t i = 0; i < blocks.size(); ++i) {
+        count += blocks[i].length;
+    }
+    return count;
+}
+
+int Translator::opIndex(uint16_t opcode) {
+    for(size_t i = 0; i < handled.size(); ++i) {
+        if(handled[i] == opcode) {
+            return i;
+        }
+    }
+    handled.push_back(opcode);
+    return handled.size() - 1;
+}
+
+void Translator::writeInstruction(FILE* out, uint16_t addr, uint16_t opcode) {
+    uint8_t x = (opcode & 0x0F00) >> 8;
+    uint8_t y = (opcode & 0x00F0) >> 4;
+    uint8_t kk = opcode & 0x00FF;
+    uint16_t nnn = opcode & 0x0FFF;
+    std::string comment = disassemble(opcode);
+
+    if(!inlined(opcode)) {
+        //The handler advances the pc itself and reads it for CALL
+        int i = opIndex(opcode);
+        fprintf(out, "    s.pc = 0x%03X; op[%d].handler(s, op[%d]);    //%s\n", addr, i, i, comment.c_str());
+        if(flowKind(opcode) == FLOW_CALL || flowKind(opcode) == FLOW_RETURN) {
+            fprintf(out, "    return s.pc;\n");
+        }
+        return;
+    }
+
+    switch(opcode & 0xF000) {
+        case 0x1000:
+            fprintf(out, "    return 0x%03X;    //%s\n", nnn, comment.c_str());
+            return;
+        case 0x3000:
+        case 0x4000:
+            fprintf(out, "    return s.V[0x%X] %s 0x%02X ? 0x%03X : 0x%03X;    //%s\n", x,
+                    (opcode & 0xF000) == 0x3000 ? "==" : "!=", kk, addr + 4, addr + 2, comment.c_str());
+            return;
+        case 0x5000:
+        case 0x9000:
+            fprintf(out, "    return s.V[0x%X] %s s.V[0x%X] ? 0x%03X : 0x%03X;    //%s\n", x,
+                    (opcode & 0xF000) == 0x5000 ? "==" : "!=", y, addr + 4, addr + 2, comment.c_str());
+            return;
+        case 0x6000:
+            fprintf(out, "    s.V[0x%X] = 0x%02X;    //%s\n", x, kk, comment.c_str());
+            return;
+        case 0x7000:
+            fprintf(out, "    s.V[0x%X] += 0x%02X;    //%s\n", x, kk, comment.c_str());
+            return;
+        case 0x8000: {
+            static const char* const ops[4] = {"=", "|=", "&=", "^="};
+            fprintf(out, "    s.V[0x%X] %s s.V[0x%X];    //%s\n", x, ops[opcode & 0xF], y, comment.c_str());
+            if(quirks.vfReset && (opcode & 0xF) != 0) {
+                fprintf(out, "    s.V[0xF] = 0;\n");
+            }
+            return;
+        }
+        case 0xA000:
+            fprintf(out, "    s.I = 0x%03X;    //%s\n", nnn, comment.c_str());
+            return;
+        case 0xB000:
+            fprintf(out, "    return 0x%03X + s.V[0x%X];    //%s\n", nnn, quirks.jumpVx ? x : 0, comment.c_str());
+            return;
+        case 0xE000:
+            fprintf(out, "    return s.V[0x%X] < 16 && ((s.keys >> s.V[0x%X]) & 1) ? 0x%03X : 0x%03X;    //%s\n", x, x,
+                    kk == 0x9E ? addr + 4 : addr + 2, kk == 0x9E ? addr + 2 : addr + 4, comment.c_str());
+            return;
+        case 0xF000:
+            switch(kk) {
+                case 0x07: fprintf(out, "    s.V[0x%X] = s.delayTimer;    //%s\n", x, comment.c_str()); return;
+                case 0x15: fprintf(out, "    s.delayTimer = s.V[0x%X];    //%s\n", x, comment.c_str()); return;
+                case 0x18: fprintf(out, "    s.soundTimer = s.V[0x%X];    //%s\n", x, comment.c_str()); return;
+                case 0x1E: fprintf(out, "    s.I += s.V[0x%X];    //%s\n", x, comment.c_str()); return;
+            }
+            return;
+    }
+}
+
+void Translator::write(FILE* out, const std::string& name) {
+    fprintf(out, "//Generated by ch8aot from %s for the %s profile. Do not edit.\n\n", name.c_str(), quirksName(profile));
+    fprintf(out, "#include \"aot.h\"\n\n");
+
+    //Number the instructions handed to the core before writing op[]
+    for(size_t b = 0; b < blocks.size(); ++b) {
+        for(int i = 0; i < blocks[b].length; ++i) {
+            uint16_t opcode = fetch(blocks[b].address + 2 * i);
+            if(!inlined(opcode)) {
+                opIndex(opcode);
+            }
+        }
+    }
+
+    fprintf(out, "static const uint8_t rom[%d] = {", (int)rom.size());
+    for(size_t i = 0; i < rom.size(); ++i) {
+        fprintf(out, "%s0x%02X,", i % 16 == 0 ? "\n    " : " ", rom[i]);
+    }
+    fprintf(out, "\n};\n\n");
+
+    //One spare entry keeps the arrays legal when every instruction is inlined
+    fprintf(out, "static const uint16_t opcodes[%d] = {", (int)handled.size() + 1);
+    for(size_t i = 0; i < handled.size(); ++i) {
+        fprintf(out, "%s0x%04X,", i % 8 == 0 ? "\n    " : " ", handled[i]);
+    }
+    fprintf(out, "\n};\nstatic Chip8Op op[%d];\n\n", (int)handled.size() + 1);
+
+    for(size_t b = 0; b < blocks.size(); ++b) {
+        const Block& block = blocks[b];
+        //A lone 1nnn is the only instruction that never touches the state
+        bool jumpOnly = block.length == 1 && (fetch(block.address) & 0xF000) == 0x1000;
+        fprintf(out, "static uint16_t block_%03X(Chip8State&%s) {\n", block.address, jumpOnly ? "" : " s");
+        uint16_t addr = block.address;
+        for(int i = 0; i < block.length; ++i, addr += 2) {
+            writeInstruction(out, addr, fetch(addr));
+        }
+        if(flowKind(fetch(addr - 2)) == FLOW_NONE) {
+            fprintf(out, "    return 0x%03X;\n", addr);
+        }
+        fprintf(out, "}\n\n");
+    }
+
+    fprintf(out, "static const Chip8AotBlock blocks[%d] = {\n", (int)blocks.size());
+    for(size_t b = 0; b < blocks.size(); ++b) {
+        fprintf(out, "    {0x%03X, %d, block_%03X},\n", blocks[b].address, blocks[b].length, blocks[b].address);
+    }
+    fprintf(out, "};\n\n");
+
+    static const char* const profiles[QUIRKS_COUNT] = {"QUIRKS_MODERN", "QUIRKS_VIP", "QUIRKS_CHIP48", "QUIRKS_SCHIP"};
+    fprintf(out, "static const Chip8AotProgram program = {\n");
+    fprintf(out, "    \"%s\", rom, sizeof(rom), %s,\n", name.c_str(), profiles[profile]);
+    fprintf(out, "    blocks, %d, op, opcodes, %d\n", (int)blocks.size(), (int)handled.size());
+    fprintf(out, "};\n\nstatic Chip8AotLink registration(program);\n");
+}
+
+int main(int argc, char* argv[]) {
+    Chip8Quirks quirks = QUIRKS_MODERN;
+    std::vector<std::string> files;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if(!parseQuirks(argv[++i], quirks)) {
+                usage();
+                return 1;
+            }
+        }
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            files.push_back(argv[i]);
+        }
+    }
+    if(files.size() != 2) {
+        usage();
+        return 0;
+    }
+
+    std::ifstream romStream(files[0], std::ios::binary);
+    if(!romStream.is_open()) {
+        std::cout << "Error: Failed to open " << files[0] << "\n";
+        return 1;
+    }
+    std::vector<uint8_t> rom(std::istreambuf_iterator<char>(romStream), {});
+    if(rom.empty() || rom.size() > 0x1000 - 0x200) {
+        std::cout << "Error: " << files[0] << " does not fit in memory\n";
+        return 1;
+    }
+
+    Translator translator(rom, quirks);
+    translator.walk();
+
+    FILE* out = fopen(files[1].c_str(), "w");
+    if(out == NULL) {
+        printf("Error: Failed to write %s\n", files[1].c_str());
+        return 1;
+    }
+    std::string name = files[0].substr(files[0].find_last_of("/\\") + 1);
+    translator.write(out, name);
+    fclose(out);
+
+    printf("%d blocks, %d of %d reachable instructions translated\n",
+           translator.blockCount(), translator.translatedCount(), translator.reachedCount());
+    return 0;
+}
@@ -0,0 +1,97 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+//Conformance front end: runs every case in a goldens file headless, in
+//parallel, and checks its frame hashes. A failing case's display is written
+//to <case>-<frame>.pbm in --out. --update records the hashes as run instead,
+//for new checks or after an intended change in behavior.
+
+#include "conformance.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+static void usage() {
+    std::cout << "Usage: ./chip8-conformance [--jit] [--threads N] [--out DIR] [--update] [goldens file]\n";
+}
+
+int main(int argc, char* argv[]) {
+    const char* goldensFile = "roms/goldens.txt";
+    std::string outDir = ".";
+    Chip8::Engine engine = Chip8::INTERPRETER;
+    int threads = 0;
+    bool update = false;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--jit") == 0) {
+            engine = Chip8::JIT;
+        }
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outDir = argv[++i];
+        }
+        else if(strcmp(argv[i], "--update") == 0) {
+            update = true;
+        }
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            goldensFile = argv[i];
+        }
+    }
+
+    GoldenSuite suite;
+    if(!suite.load(goldensFile)) {
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+    std::vector<GoldenResult> results = suite.run(engine, threads);
+    auto end = std::chrono::steady_clock::now();
+
+    static const char* statuses[] = {"pass", "FAIL", "unknown", "load-failed"};
+    uint64_t byStatus[GOLDEN_LOAD_FAILED + 1] = {0};
+    printf("%-28s %-8s %-6s %-12s %s\n", "case", "profile", "checks", "result", "");
+    for(size_t i = 0; i < results.size(); ++i) {
+        const GoldenCase& c = suite.cases[i];
+        const GoldenResult& result = results[i];
+        ++byStatus[result.status];
+        printf("%-28s %-8s %-6zu %-12s", c.name.c_str(), quirksName(c.quirks), c.checks.size(), statuses[result.status]);
+        if(result.status == GOLDEN_FAIL) {
+            std::string image = outDir + "/" + c.name + "-" + std::to_string(result.frame) + ".pbm";
+            printf(" frame %llu: %016llx, expected %016llx", (unsigned long long)result.frame,
+                   (unsigned long long)result.actual, (unsigned long long)result.expected);
+            if(!update && GoldenSuite::writePbm(image.c_str(), result.screen)) {
+                printf(", wrote %s", image.c_str());
+            }
+        }
+        printf("\n");
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("Cases:               %zu\n", results.size());
+    printf("Results:            ");
+    for(int s = 0; s <= GOLDEN_LOAD_FAILED; ++s) {
+        printf(" %s=%llu", statuses[s], (unsigned long long)byStatus[s]);
+    }
+    printf("\n");
+    printf("Wall time:           %.3f s\n", seconds);
+
+    if(update) {
+        if(byStatus[GOLDEN_LOAD_FAILED] != 0) {
+            return 1;
+        }
+        suite.update(results);
+        if(!suite.save(goldensFile)) {
+            return 1;
+        }
+        printf("Updated %s\n", goldensFile);
+        return 0;
+    }
+    return byStatus[GOLDEN_PASS] != results.size();
+}
@@ -0,0 +1,175 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+//Fleet front end: runs many headless sessions at once over every core and
+//reports how each one ended. Each ROM is run --copies times, copy i with
+//seed (--seed + i), so a corpus doubles as a soak test. --lockstep runs the
+//copies of a ROM 32 at a time on the SIMD engine. --quirks applies to the
+//ROMs after it, so one run can mix profiles.
+
+#include "fleet.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static void usage() {
+    std::cout << "Usage: ./chip8-fleet [--threads N] [--copies N] [--frames N] [--ipf N] [--slice N]\n";
+    std::cout << "                     [--seed N] [--replay MOVIE] [--jit] [--aot] [--lockstep] [--no-idle-skip] [--quiet]\n";
+    std::cout << "                     [[--quirks modern|vip|chip48|schip] ROM...]...\n";
+}
+
+int main(int argc, char* argv[]) {
+    int threads = 0;
+    uint32_t copies = 1;
+    uint64_t frames = 600;
+    uint32_t ipf = 10;
+    uint32_t slice = 60;
+    uint64_t seed = 1;
+    bool quiet = false;
+    bool lockstep = false;
+    bool idleSkip = true;
+    const char* replayFile = NULL;
+    Chip8::Engine engine = Chip8::INTERPRETER;
+    Chip8Quirks quirks = QUIRKS_MODERN;
+    std::vector<std::string> romFiles;
+    std::vector<Chip8Quirks> romQuirks;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--copies") == 0 && i + 1 < argc) {
+            copies = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            ipf = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--slice") == 0 && i + 1 < argc) {
+            slice = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--jit") == 0) {
+            engine = Chip8::JIT;
+        }
+        else if(strcmp(argv[i], "--aot") == 0) {
+            engine = Chip8::AOT;
+        }
+        else if(strcmp(argv[i], "--lockstep") == 0) {
+            lockstep = true;
+        }
+        else if(strcmp(argv[i], "--no-idle-skip") == 0) {
+            idleSkip = false;
+        }
+        else if(strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        }
+        else if(strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if(!parseQuirks(argv[++i], quirks)) {
+                usage();
+                return 1;
+            }
+        }
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            romFiles.push_back(argv[i]);
+            romQuirks.push_back(quirks);
+        }
+    }
+
+    if(romFiles.empty() || ipf == 0 || copies == 0) {
+        usage();
+        return 0;
+    }
+
+    //Every copy of a movie replay must match the recording, so it fixes seed, ipf and quirks
+    Movie movie;
+    if(replayFile != NULL) {
+        if(!movie.load(replayFile)) {
+            return 1;
+        }
+        ipf = movie.ipf;
+        if(frames == 0 || frames > movie.length) {
+            frames = movie.length;
+        }
+    }
+
+    //Read each ROM once; instances copy it out of memory
+    std::vector<std::vector<uint8_t>> roms(romFiles.size());
+    for(size_t r = 0; r < romFiles.size(); ++r) {
+        std::ifstream romStream(romFiles[r], std::ios::binary);
+        if(!romStream.is_open()) {
+            std::cout << "Error: Failed to open " << romFiles[r] << "\n";
+            return 1;
+        }
+        roms[r].assign(std::istreambuf_iterator<char>(romStream), {});
+    }
+
+    std::vector<FleetJob> jobs;
+    for(size_t r = 0; r < roms.size(); ++r) {
+        for(uint32_t c = 0; c < copies; ++c) {
+            FleetJob job;
+            job.rom = &roms[r];
+            job.seed = replayFile != NULL ? movie.seed : seed + c;
+            job.ipf = ipf;
+            job.frames = frames;
+            job.quirks = replayFile != NULL ? movie.quirks : romQuirks[r];
+            job.movie = replayFile != NULL ? &movie : NULL;
+            jobs.push_back(job);
+        }
+    }
+
+    Fleet fleet(threads, slice, lockstep);
+    fleet.setIdleSkip(idleSkip);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<FleetResult> results = fleet.run(jobs, engine);
+    auto end = std::chrono::steady_clock::now();
+
+    uint64_t totalCycles = 0;
+    uint64_t totalSkipped = 0;
+    uint64_t totalFrames = 0;
+    uint64_t byReason[FLEET_LOAD_FAILED + 1] = {0};
+    if(!quiet) {
+        printf("%-6s %-24s %-12s %-11s %-12s %-10s %s\n", "#", "rom", "seed", "exit", "cycles", "frames", "frame hash");
+    }
+    for(size_t i = 0; i < results.size(); ++i) {
+        const FleetResult& result = results[i];
+        totalCycles += result.cycles;
+        totalSkipped += result.skipped;
+        totalFrames += result.frames;
+        ++byReason[result.reason];
+        if(!quiet) {
+            printf("%-6zu %-24s %-12llu %-11s %-12llu %-10llu %016llx\n", i, romFiles[i / copies].c_str(),
+                   (unsigned long long)jobs[i].seed, fleetExitName(result.reason),
+                   (unsigned long long)result.cycles, (unsigned long long)result.frames,
+                   (unsigned long long)result.frameHash);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("Sessions:            %zu on %d workers\n", results.size(), fleet.workerCount());
+    printf("Exits:              ");
+    for(int r = 0; r <= FLEET_LOAD_FAILED; ++r) {
+        printf(" %s=%llu", fleetExitName((FleetExit)r), (unsigned long long)byReason[r]);
+    }
+    printf("\n");
+    printf("Cycles:              %llu\n", (unsigned long long)totalCycles);
+    printf("Idle-skipped:        %llu\n", (unsigned long long)totalSkipped);
+    printf("Frames:              %llu\n", (unsigned long long)totalFrames);
+    printf("Wall time:           %.3f s\n", seconds);
+    printf("Instructions/sec:    %.0f\n", (totalCycles - totalSkipped) / seconds);     //Executed only
+    return byReason[FLEET_LOAD_FAILED] != 0;
+}
@@ -0,0 +1,142 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+//In-process fuzzer for the core. Linked with -fsanitize=fuzzer this is a
+//libFuzzer target, and the guest edge bitmap goes to libFuzzer as extra
+//counters next to its own coverage of the core. Built with -DCHIP8_FUZZ_MAIN
+//it is its own driver: it replays the inputs named on the command line, or
+//mutates random ROMs and reports executions per second.
+
+#include "fuzz.h"
+#include <cstdio>
+
+//libFuzzer treats every byte in this section as a coverage counter
+#ifdef __linux__
+__attribute__((used, section("__libfuzzer_extra_counters")))
+#endif
+static uint8_t edges[Chip8Fuzzer::EDGES];
+
+static Chip8Fuzzer fuzzer(edges);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzzer.run(data, size);
+    return 0;
+}
+
+#ifdef CHIP8_FUZZ_MAIN
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static void usage() {
+    std::cout << "Usage: ./chip8-fuzz [--runs N] [--cycles N] [--seed N] [--quirks modern|vip|chip48|schip]\n";
+    std::cout << "                    [input files...]\n";
+}
+
+//Small random edits of the kind that move a ROM's control flow around
+static void mutate(std::vector<uint8_t>& input, uint64_t& rng) {
+    int edits = 1 + Chip8Core::nextRandom(rng) % 4;
+    for(int i = 0; i < edits; ++i) {
+        size_t at = (Chip8Core::nextRandom(rng) << 8 | Chip8Core::nextRandom(rng)) % input.size();
+        switch(Chip8Core::nextRandom(rng) % 4) {
+            case 0: input[at] ^= 1 << (Chip8Core::nextRandom(rng) & 7); break;
+            case 1: input[at] = Chip8Core::nextRandom(rng); break;
+            case 2:
+                if(input.size() < 0x1000 - 0x200) {
+                    input.insert(input.begin() + at, Chip8Core::nextRandom(rng));
+                }
+                break;
+            case 3:
+                if(input.size() > 4) {
+                    input.erase(input.begin() + at);
+                }
+                break;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t runs = 10000000;
+    uint64_t cycles = 1000;
+    uint64_t seed = 1;
+    Chip8Quirks quirks = QUIRKS_MODERN;
+    std::vector<std::string> files;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            runs = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if(!parseQuirks(argv[++i], quirks)) {
+                usage();
+                return 1;
+            }
+        }
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            files.push_back(argv[i]);
+        }
+    }
+    Chip8Fuzzer local(edges, quirks, cycles);
+
+    //Replay: report how each input ended
+    if(!files.empty()) {
+        for(size_t f = 0; f < files.size(); ++f) {
+            std::ifstream in(files[f], std::ios::binary);
+            std::vector<uint8_t> input(std::istreambuf_iterator<char>(in), {});
+            if(!local.run(input.data(), input.size())) {
+                printf("%s: does not fit\n", files[f].c_str());
+                continue;
+            }
+            const Chip8State& s = local.machine();
+            printf("%s: %llu cycles, pc %x, fault: %s, new edges: %u\n", files[f].c_str(),
+                   (unsigned long long)s.cycles, s.pc, faultName(s.fault), local.newEdges());
+        }
+        return 0;
+    }
+
+    //Standalone fuzzing: keep any input that found a new edge and mutate from those
+    uint64_t rng = Chip8Core::seedRandom(seed);
+    std::vector<std::vector<uint8_t>> corpus(1, std::vector<uint8_t>(66));
+    for(size_t i = 0; i < corpus[0].size(); ++i) {
+        corpus[0][i] = Chip8Core::nextRandom(rng);
+    }
+    uint64_t faults[FAULT_BAD_OPCODE + 1] = {0};
+    uint64_t edgeCount = 0;
+    std::vector<uint8_t> input;
+    auto start = std::chrono::steady_clock::now();
+    for(uint64_t r = 0; r < runs; ++r) {
+        input = corpus[(Chip8Core::nextRandom(rng) << 8 | Chip8Core::nextRandom(rng)) % corpus.size()];
+        mutate(input, rng);
+        local.run(input.data(), input.size());
+        ++faults[local.machine().fault];
+        if(local.newEdges() != 0) {
+            edgeCount += local.newEdges();
+            corpus.push_back(input);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("Runs:                %llu\n", (unsigned long long)runs);
+    printf("Execs/sec:           %.0f\n", runs / seconds);
+    printf("Edges:               %llu\n", (unsigned long long)edgeCount);
+    printf("Corpus:              %zu\n", corpus.size());
+    for(int f = 0; f <= FAULT_BAD_OPCODE; ++f) {
+        printf("%-20s %llu\n", (std::string(faultName((Chip8Fault)f)) + ":").c_str(), (unsigned long long)faults[f]);
+    }
+    return 0;
+}
+#endif
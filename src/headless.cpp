@@ -0,0 +1,208 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+//Headless front end: runs the core with no window and no SDL dependency,
+//as fast as the host allows. Used for benchmarking and for display-less CI.
+//--benchmark rates count executed instructions only; --no-idle-skip runs idle
+//loops out in full, to time an engine on them rather than the skipping.
+
+#include "chip8.h"
+#include "scheduler.h"
+#include "movie.h"
+#include "aot.h"
+#include <cstring>
+
+static void usage() {
+    std::cout << "Usage: ./chip8-headless [--benchmark] [--jit | --aot] [--ipf N] [--cycles N | --frames N]\n";
+    std::cout << "                        [--seed N] [--replay MOVIE] [--no-idle-skip] [--stats FILE] [--profile FILE]\n";
+    std::cout << "                        [--trace FILE] [--quirks modern|vip|chip48|schip] [path to ROM]\n";
+}
+
+int main (int argc, char* argv[]) {
+    bool benchmark = false;
+    bool idleSkip = true;
+    //A binary with a translation linked in runs it by default, embedded ROM included
+    const Chip8AotProgram* translation = Chip8Aot::linked();
+    Chip8::Engine engine = translation != NULL ? Chip8::AOT : Chip8::INTERPRETER;
+    uint64_t maxCycles = 0;     //0 = run until the ROM ends
+    uint64_t maxFrames = 0;
+    uint32_t instructionsPerFrame = DEFAULT_IPF;
+    const char* statsFile = NULL;
+    const char* profileFile = NULL;
+    const char* traceFile = NULL;
+    const char* replayFile = NULL;
+    bool seeded = false;
+    uint64_t seed = 0;
+    Chip8Quirks quirks = QUIRKS_MODERN;
+    std::string romFile;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--benchmark") == 0) {
+            benchmark = true;
+        }
+        else if(strcmp(argv[i], "--no-idle-skip") == 0) {
+            idleSkip = false;
+        }
+        else if(strcmp(argv[i], "--jit") == 0) {
+            engine = Chip8::JIT;
+        }
+        else if(strcmp(argv[i], "--aot") == 0) {
+            engine = Chip8::AOT;
+        }
+        else if(strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            instructionsPerFrame = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            maxCycles = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            maxFrames = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            statsFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profileFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+            seeded = true;
+        }
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if(!parseQuirks(argv[++i], quirks)) {
+                usage();
+                return 1;
+            }
+        }
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            romFile = argv[i];
+        }
+    }
+
+    //A movie fixes everything that affects execution
+    Movie movie;
+    if(replayFile != NULL) {
+        if(!movie.load(replayFile)) {
+            return 1;
+        }
+        seed = movie.seed;
+        seeded = true;
+        instructionsPerFrame = movie.ipf;
+        quirks = movie.quirks;
+        if(maxFrames == 0) {
+            maxFrames = movie.length;
+        }
+    }
+
+    if((romFile.empty() && translation == NULL) || instructionsPerFrame == 0) {
+        usage();
+        return 0;
+    }
+
+    if(benchmark && maxCycles == 0 && maxFrames == 0) {
+        //Most ROMs loop forever, so a benchmark needs a bound
+        maxCycles = 100000000;
+    }
+
+    Chip8 chip8(false, quirks, engine);
+    chip8.setIdleSkip(idleSkip);
+    if(seeded) {
+        chip8.setSeed(seed);
+    }
+    chip8.init();
+    if(romFile.empty()) {
+        chip8.loadRom(std::vector<uint8_t>(translation->rom, translation->rom + translation->romSize));
+    }
+    else if(!chip8.loadRom(romFile)) {
+        return 1;
+    }
+    Profiler profiler;
+    if(profileFile != NULL) {
+        chip8.setProfiler(&profiler);
+    }
+    TraceRing trace;
+    if(traceFile != NULL) {
+        chip8.setTrace(&trace);
+    }
+
+    //Same frame batching as the windowed front end, minus the sleeping
+    uint64_t frames = 0;
+    size_t cursor = 0;
+    std::vector<Chip8KeyEvent> changes;
+    auto start = std::chrono::steady_clock::now();
+    while(!chip8.endEmulation()
+          && (maxCycles == 0 || chip8.cycleCount() < maxCycles)
+          && (maxFrames == 0 || frames < maxFrames)) {
+        uint64_t batch = instructionsPerFrame;
+        if(maxCycles != 0 && maxCycles - chip8.cycleCount() < batch) {
+            batch = maxCycles - chip8.cycleCount();
+        }
+        if(replayFile != NULL) {
+            movie.changesAt(frames, cursor, changes);
+        }
+        chip8.runFrame(batch, changes.data(), changes.size());
+        ++frames;
+        if(chip8.fault() != FAULT_NONE) {
+            printf("Faulted: %s\n", faultName(chip8.fault()));
+            break;
+        }
+
+        //With no key changes left, an Fx0A wait with no timers running never ends. The windowed
+        //front end stops counting frames while blocked there, so a recorded change lands on the next frame.
+        bool moreInput = replayFile != NULL && cursor < movie.events.size();
+        if(chip8.waitingForKey() && !chip8.timersActive() && !moreInput) {
+            printf("Halted waiting for a key\n");
+            break;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    if(statsFile != NULL) {
+        PhaseTimes times;
+        times.cpu = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        writeStatsJson(statsFile, chip8.statistics(), times, chip8.cycleCount(), frames);
+    }
+    if(profileFile != NULL) {
+        profiler.report(profileFile, chip8.memoryData());
+    }
+    if(traceFile != NULL) {
+        trace.dump(traceFile);
+    }
+
+    if(replayFile != NULL) {
+        printf("Frame hash:          %016llx\n", (unsigned long long)chip8.frameHash());
+    }
+    if(benchmark && chip8.cycleCount() > 0) {
+        double seconds = std::chrono::duration<double>(end - start).count();
+        //Idle-skipped instructions cost next to nothing, so the rates count only those run
+        uint64_t cycles = chip8.cycleCount();
+        uint64_t skipped = chip8.skippedCycles();
+        uint64_t executed = cycles - skipped;
+        printf("Cycles:              %llu\n", (unsigned long long)cycles);
+        printf("Executed:            %llu\n", (unsigned long long)executed);
+        printf("Idle-skipped:        %llu\n", (unsigned long long)skipped);
+        printf("Frames:              %llu\n", (unsigned long long)frames);
+        printf("Wall time:           %.3f s\n", seconds);
+        if(executed > 0) {
+            printf("Instructions/sec:    %.0f\n", executed / seconds);
+            printf("ns/instruction:      %.2f\n", seconds * 1e9 / executed);
+        }
+        printf("Frames/wall-second:  %.0f\n", frames / seconds);
+    }
+    else {
+        chip8.displayStatus();
+    }
+    return 0;
+}
@@ -5,63 +5,399 @@
 
 #include "chip8.h"
 #include "screen.h"
-#include <chrono>
+#include "beeper.h"
+#include "scheduler.h"
+#include "triplebuffer.h"
+#include "rewind.h"
+#include "movie.h"
+#include "aot.h"
+#include <cstring>
 #include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
 
 #define MEMDUMP false
 #define DEBUG false
 
-const uint32_t frameTime = 2;
+struct Frame {
+    uint64_t rows[32];
+};
 
-int main (int argc, char* argv[]) {
+//Shared between the emulator thread and the main (render/input) thread
+struct FrontEnd {
+    TripleBuffer<Frame> frames;
+    KeyChangeQueue* keys = NULL;        //Filled by the main thread, drained by the emulator thread
+    std::atomic<bool> fastForward{false};
+    std::atomic<bool> rewinding{false};
+    std::atomic<bool> quit{false};
 
-    if(argc < 2) {
-        std::cout << "Usage: ./chip8.exe [path to ROM]\n";
-        return 0;
-    }
+    //The emulator thread sleeps here while the ROM waits in Fx0A with no timers running
+    std::mutex inputMutex;
+    std::condition_variable inputChanged;
+    std::atomic<bool> idle{false};
 
-    const std::string romFile = argv[1];
+    PhaseTimes times;
+    uint64_t framesRun = 0;             //Emulator thread only
+    Movie* movie = NULL;                //Recording, emulator thread only
 
-    Chip8 chip8(MEMDUMP);
-    chip8.init();
-    chip8.loadRom(romFile);
+    void notifyInput() {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        inputChanged.notify_all();
+    }
+};
 
-    Screen screen;
-    screen.init();
+static const char* statsFile = NULL;
+static volatile sig_atomic_t statsRequested = 0;
 
-    uint32_t start_time;
-    uint32_t last_time;
-    uint32_t elapsed_time;
+static void requestStats(int) {
+    statsRequested = 1;
+}
 
-    bool quit = false;
-    last_time = SDL_GetTicks();
+//Trace ring, dumped on SIGUSR2, on a crash and (in DEBUG builds) at exit
+static const char* traceFile = NULL;
+static TraceRing* traceRing = NULL;
+static volatile sig_atomic_t traceRequested = 0;
 
-    while(!quit) {
-        start_time = SDL_GetTicks();
-        elapsed_time = start_time - last_time;
+static void requestTrace(int) {
+    traceRequested = 1;
+}
 
-        //Handle SDL Events (Keyboard)
-        screen.handleInput(chip8.keyboard);
+static void crashed(int sig) {
+    int fd = open(traceFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd >= 0) {
+        traceRing->dump(fd);
+        close(fd);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
 
-        chip8.emulateCycle();
+//Runs the core in 60 Hz frames and publishes each finished frame.
+//Never waits on the renderer.
+//
+//A frame's batch runs all at once when the frame starts, so it stands for the
+//wall time since the previous one started. Each key change that came in over
+//that time lands the same fraction of the way into the batch: input is a
+//frame late, always by the same amount, and a tap shorter than a frame still
+//reaches the ROM. The changes go into the movie at the instructions they hit.
+static void emulate(Chip8& chip8, FrontEnd& frontEnd, FrameScheduler& scheduler) {
+    typedef std::chrono::steady_clock Clock;
+    uint64_t publishedHash = 0;
+    RewindBuffer history;
+    Chip8State snapshot = {};
+    std::vector<Chip8KeyEvent> changes;
+    KeyChange next;
+    bool pending = false;               //next was popped but belongs to a later frame
+    Clock::time_point frameStart = Clock::now();
+    while(!frontEnd.quit.load()) {
+        Clock::time_point lastStart = frameStart;
+        frameStart = Clock::now();
+        uint32_t ipf = scheduler.instructionsPerFrame();
+        changes.clear();
+        while(pending || frontEnd.keys->pop(next)) {
+            pending = next.time >= frameStart;
+            if(pending) {
+                break;
+            }
+            uint32_t cycle = 0;
+            if(next.time > lastStart) {
+                cycle = ipf * (uint64_t)(next.time - lastStart).count() / (frameStart - lastStart).count();
+            }
+            changes.push_back({cycle, next.keys});
+        }
+        scheduler.setFastForward(frontEnd.fastForward.load(std::memory_order_relaxed));
+
+        //Rewinding replays history backwards one frame per tick
+        bool rewinding = frontEnd.rewinding.load(std::memory_order_relaxed);
+        STATS(uint64_t start = statsClockNs());
+        if(rewinding) {
+            //Nothing runs, so the keys just follow along
+            for(const Chip8KeyEvent& change : changes) {
+                chip8.setKeys(change.keys);
+            }
+            if(history.rewind(snapshot)) {
+                chip8.loadState(snapshot);
+                --frontEnd.framesRun;
+                if(frontEnd.movie != NULL) {
+                    frontEnd.movie->truncate(frontEnd.framesRun);
+                }
+            }
+        }
+        else if(chip8.fault() != FAULT_NONE) {
+            for(const Chip8KeyEvent& change : changes) {
+                chip8.setKeys(change.keys);
+            }
+        }
+        else {
+            if(frontEnd.movie != NULL) {
+                frontEnd.movie->record(frontEnd.framesRun, chip8.keys());
+                for(const Chip8KeyEvent& change : changes) {
+                    frontEnd.movie->record(frontEnd.framesRun, change.keys, change.cycle);
+                }
+            }
+            chip8.runFrame(ipf, changes.data(), changes.size());
+            chip8.saveState(snapshot);
+            history.push(snapshot);
+            ++frontEnd.framesRun;
+            //A faulted machine stays on screen, frozen, so it can be rewound
+            if(chip8.fault() != FAULT_NONE) {
+                printf("Faulted: %s. Hold Backspace to rewind.\n", faultName(chip8.fault()));
+            }
+        }
+        STATS(frontEnd.times.cpu += statsClockNs() - start);
         if(chip8.endEmulation())
-            quit = true;
+            frontEnd.quit = true;
 
-        //Draw to SDL window
+        //All DRWs of a frame go out as one publish, and only if the visible
+        //image changed: erase-and-redraw within a frame publishes nothing
         if(chip8.drawFlag){
             chip8.drawFlag = false;
-            screen.draw(chip8.screenBuffer);
+            if(chip8.takeDirtyRows() != 0) {
+                uint64_t hash = chip8.frameHash();
+                if(hash != publishedHash) {
+                    publishedHash = hash;
+                    memcpy(frontEnd.frames.back().rows, chip8.screenRows(), sizeof(Frame::rows));
+                    frontEnd.frames.publish();
+                }
+            }
         }
 
-        if(DEBUG) {
-            chip8.displayStatus();
+        if(traceRequested && traceRing != NULL) {
+            traceRequested = 0;
+            traceRing->dump(traceFile);
         }
 
-        if(SDL_GetTicks() - start_time < frameTime) {
-            SDL_Delay(frameTime - (SDL_GetTicks() - start_time));
+        if(statsRequested && statsFile != NULL) {
+            statsRequested = 0;
+            writeStatsJson(statsFile, chip8.statistics(), frontEnd.times, chip8.cycleCount(), frontEnd.framesRun);
         }
 
+        STATS(start = statsClockNs());
+
+        //Halted on Fx0A with nothing left to count down: block until a key
+        //changes instead of running empty frames
+        if(!rewinding && chip8.waitingForKey() && !chip8.timersActive()) {
+            std::unique_lock<std::mutex> lock(frontEnd.inputMutex);
+            frontEnd.idle = true;
+            frontEnd.inputChanged.wait(lock, [&] {
+                return frontEnd.quit.load() || pending || !frontEnd.keys->empty() || frontEnd.rewinding.load();
+            });
+            frontEnd.idle = false;
+            scheduler.resync();
+        }
+        else {
+            scheduler.waitForNextFrame();
+        }
+        STATS(frontEnd.times.sleep += statsClockNs() - start);
+    }
+}
+
+static void usage() {
+    std::cout << "Usage: ./chip8.exe [--jit | --aot] [--ipf N] [--speed X] [--scale N] [--fg RRGGBB] [--bg RRGGBB]\n";
+    std::cout << "                   [--seed N] [--record MOVIE] [--stats FILE] [--profile FILE] [--trace FILE]\n";
+    std::cout << "                   [--quirks modern|vip|chip48|schip] [--mute] [path to ROM]\n";
+    std::cout << "Hold Tab to fast-forward, Backspace to rewind.\n";
+}
+
+int main (int argc, char* argv[]) {
+    //A binary with a translation linked in runs it by default, embedded ROM included
+    const Chip8AotProgram* translation = Chip8Aot::linked();
+    Chip8::Engine engine = translation != NULL ? Chip8::AOT : Chip8::INTERPRETER;
+    uint32_t instructionsPerFrame = DEFAULT_IPF;
+    double speed = 1.0;
+    int scale = 8;
+    uint32_t fg = 0xFFFFFF;
+    uint32_t bg = 0x000000;
+    const char* profileFile = NULL;
+    const char* recordFile = NULL;
+    bool seeded = false;
+    uint64_t seed = 0;
+    Chip8Quirks quirks = QUIRKS_MODERN;
+    bool mute = false;
+    std::string romFile;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--jit") == 0) {
+            engine = Chip8::JIT;
+        }
+        else if(strcmp(argv[i], "--aot") == 0) {
+            engine = Chip8::AOT;
+        }
+        else if(strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            instructionsPerFrame = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            speed = strtod(argv[++i], NULL);
+        }
+        else if(strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--fg") == 0 && i + 1 < argc) {
+            fg = strtoul(argv[++i], NULL, 16);
+        }
+        else if(strcmp(argv[i], "--bg") == 0 && i + 1 < argc) {
+            bg = strtoul(argv[++i], NULL, 16);
+        }
+        else if(strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            statsFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profileFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            traceFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+            seeded = true;
+        }
+        else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordFile = argv[++i];
+        }
+        else if(strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if(!parseQuirks(argv[++i], quirks)) {
+                usage();
+                return 1;
+            }
+        }
+        else if(strcmp(argv[i], "--mute") == 0) {
+            mute = true;
+        }
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            romFile = argv[i];
+        }
+    }
+
+    if((romFile.empty() && translation == NULL) || instructionsPerFrame == 0 || scale <= 0) {
+        usage();
+        return 0;
+    }
+
+#ifdef SIGUSR1
+    //kill -USR1 dumps the stats file without stopping the emulator
+    signal(SIGUSR1, requestStats);
+#endif
+    if(DEBUG && traceFile == NULL) {
+        traceFile = "chip8.trace";
+    }
+
+    Chip8 chip8(MEMDUMP, quirks, engine);
+    if(seeded) {
+        chip8.setSeed(seed);
+    }
+    chip8.init();
+    if(romFile.empty()) {
+        chip8.loadRom(std::vector<uint8_t>(translation->rom, translation->rom + translation->romSize));
+    }
+    else {
+        chip8.loadRom(romFile);
+    }
+    Profiler profiler;
+    if(profileFile != NULL) {
+        chip8.setProfiler(&profiler);
+    }
+    TraceRing* trace = traceFile != NULL ? new TraceRing() : NULL;
+    if(trace != NULL) {
+        traceRing = trace;
+        chip8.setTrace(trace);
+#ifdef SIGUSR2
+        //kill -USR2 dumps the last instructions without stopping the emulator
+        signal(SIGUSR2, requestTrace);
+#endif
+        signal(SIGSEGV, crashed);
+        signal(SIGABRT, crashed);
+        signal(SIGFPE, crashed);
+        signal(SIGILL, crashed);
+    }
+
+    Screen screen(scale, fg, bg);
+    screen.init();
+    //The emulator thread posts sound timer edges, the audio callback plays them
+    Beeper beeper;
+    if(!mute && beeper.init()) {
+        chip8.setSound(&beeper.edges());
+    }
+
+    FrameScheduler scheduler(instructionsPerFrame, speed);
+    FrontEnd frontEnd;
+    frontEnd.keys = &screen.keyChanges();
+    Movie movie;
+    if(recordFile != NULL) {
+        movie.seed = chip8.seed();
+        movie.ipf = instructionsPerFrame;
+        movie.quirks = quirks;
+        frontEnd.movie = &movie;
+    }
+    std::thread emulator(emulate, std::ref(chip8), std::ref(frontEnd), std::ref(scheduler));
+
+    //SDL wants video and events on the thread that created the window,
+    //so the main thread renders and handles input while the core runs elsewhere
+    FrameScheduler display;
+    display.setFrameRate(screen.refreshRate());
+    auto handleInput = [&](int waitMs) {
+        uint16_t keys = screen.keys.load();
+        if(!screen.handleInput(waitMs)) {
+            frontEnd.quit = true;
+        }
+        if(screen.keys.load() != keys || frontEnd.quit.load()) {
+            frontEnd.notifyInput();
+        }
+        frontEnd.fastForward.store(screen.fastForward, std::memory_order_relaxed);
+        if(screen.rewinding != frontEnd.rewinding.exchange(screen.rewinding)) {
+            frontEnd.notifyInput();
+        }
+    };
+
+    while(!frontEnd.quit.load()) {
+        //While the core is idle there is nothing new to draw, so block in
+        //the event queue instead of ticking
+        bool idle = frontEnd.idle.load();
+        STATS(uint64_t start = statsClockNs());
+        handleInput(idle ? 100 : 0);
+        STATS(frontEnd.times.input += statsClockNs() - start);
+
+        //Draw only the newest finished frame; draw() skips the present
+        //when neither the frame nor the window changed
+        STATS(start = statsClockNs());
+        frontEnd.frames.update();
+        screen.draw(frontEnd.frames.front().rows);
+        STATS(frontEnd.times.render += statsClockNs() - start);
+
+        if(idle) {
+            display.resync();
+        }
+        else {
+            //Spend the wait for the next frame in the event queue, so key
+            //changes are stamped as they arrive rather than a frame later
+            for(int ms = display.millisecondsLeft(); ms > 1 && !frontEnd.quit.load(); ms = display.millisecondsLeft()) {
+                handleInput(ms - 1);
+            }
+            display.waitForNextFrame();
+        }
+    }
+
+    frontEnd.notifyInput();
+    emulator.join();
+    if(statsFile != NULL) {
+        writeStatsJson(statsFile, chip8.statistics(), frontEnd.times, chip8.cycleCount(), frontEnd.framesRun);
+    }
+    if(profileFile != NULL) {
+        profiler.report(profileFile, chip8.memoryData());
+    }
+    if(recordFile != NULL) {
+        movie.save(recordFile);
+    }
+    if(DEBUG && trace != NULL) {
+        trace->dump(traceFile);
     }
+    beeper.close();
     screen.close();
     return 0;
 }
@@ -0,0 +1,96 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+//Offline decoder for trace files written by --trace: one line per
+//instruction, oldest first, with the registers the instruction wrote, or
+//with --registers the whole register file after it.
+
+#include "trace.h"
+#include "disasm.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+//Registers the instruction writes whatever the profile, as a mask with bit i = Vi:
+//Vx for loads, arithmetic, RND, Fx07 and Fx0A, V0 to Vx for Fx65, and VF for
+//carry, borrow, shift-out, collision and 8xy1/8xy2/8xy3 under vfReset
+static uint16_t writtenRegisters(uint16_t opcode) {
+    uint8_t x = (opcode >> 8) & 0xF;
+    uint8_t n = opcode & 0xF;
+    switch(opcode >> 12) {
+        case 0x6: case 0x7: case 0xC:
+            return 1 << x;
+        case 0x8:
+            return 1 << x | ((n >= 1 && n <= 7) || n == 0xE ? 0x8000 : 0);
+        case 0xD:
+            return 0x8000;
+        case 0xF:
+            switch(opcode & 0xFF) {
+                case 0x07: case 0x0A: return 1 << x;
+                case 0x65: return (2 << x) - 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool registers = argc == 3 && strcmp(argv[1], "--registers") == 0;
+    if(argc != 2 && !registers) {
+        std::cout << "Usage: ./tracedump [--registers] [trace file]\n";
+        return 0;
+    }
+    const char* path = argv[argc - 1];
+    FILE* in = fopen(path, "rb");
+    if(in == NULL) {
+        printf("Error: Failed to open %s\n", path);
+        return 1;
+    }
+
+    TraceHeader header;
+    if(fread(&header, sizeof(header), 1, in) != 1 || memcmp(header.magic, "C8TR", 4) != 0) {
+        printf("Error: %s is not a trace file\n", path);
+        fclose(in);
+        return 1;
+    }
+    if(header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord)) {
+        printf("Error: Unsupported trace version %u\n", header.version);
+        fclose(in);
+        return 1;
+    }
+
+    printf("%u instructions\n", header.count);
+    printf("%-12s %-4s %-5s %-16s %-5s %s\n", "cycle", "pc", "op", "", "I", registers ? "V0-VF" : "writes");
+    TraceRecord r;
+    TraceRecord previous;
+    for(uint32_t i = 0; i < header.count && fread(&r, sizeof(r), 1, in) == 1; ++i) {
+        printf("%-12llu %03X  %04X  %-16s %03X", (unsigned long long)r.cycle, r.pc, r.opcode,
+               disassemble(r.opcode).c_str(), r.I);
+        if(registers) {
+            printf("  ");
+            for(int v = 0; v < 16; ++v) {
+                printf(" %02X", r.V[v]);
+            }
+        }
+        else {
+            //What the opcode writes, plus anything else that changed since the
+            //record before, so no write goes unseen whatever the profile
+            uint16_t written = writtenRegisters(r.opcode);
+            for(int v = 0; i > 0 && v < 16; ++v) {
+                written |= (r.V[v] != previous.V[v]) << v;
+            }
+            for(int v = 0; v < 16; ++v) {
+                if((written >> v) & 1) {
+                    printf("   V%X=%02X", v, r.V[v]);
+                }
+            }
+        }
+        printf("\n");
+        previous = r;
+    }
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,179 @@
+/* C++ Chip-8 Interpreter
+ * Jacob Malone
+ * 2022
+ */
+
+//Differential front end: runs every ROM on the reference interpreter and on
+//each candidate engine with the same seed and random key presses, over every
+//core, and reports where any engine first disagrees with the reference.
+//Exits non-zero on any divergence, so it can gate CI. --quirks applies to
+//the ROMs after it, as in chip8-fleet.
+
+#include "verify.h"
+#include "chip8.h"
+#include "jit.h"
+#include "aot.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static void usage() {
+    std::cout << "Usage: ./chip8-verify [--engine core|interpreter|jit|aot|lockstep]... [--threads N] [--copies N]\n";
+    std::cout << "                      [--frames N] [--ipf N] [--interval N] [--seed N] [--quiet]\n";
+    std::cout << "                      [[--quirks modern|vip|chip48|schip] ROM...]...\n";
+}
+
+int main(int argc, char* argv[]) {
+    int threads = 0;
+    uint32_t copies = 4;
+    uint64_t frames = 600;
+    uint32_t ipf = 10;
+    uint64_t interval = 1000;           //Six checks over the default 600 frames of 10 instructions
+    uint64_t seed = 1;
+    bool quiet = false;
+    std::vector<VerifyEngine> engines;
+    Chip8Quirks quirks = QUIRKS_MODERN;
+    std::vector<std::string> romFiles;
+    std::vector<Chip8Quirks> romQuirks;
+
+    for(int i = 1; i < argc; ++i) {
+        VerifyEngine engine;
+        if(strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+            if(!parseVerifyEngine(argv[++i], engine)) {
+                usage();
+                return 1;
+            }
+            engines.push_back(engine);
+        }
+        else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        }
+        else if(strcmp(argv[i], "--copies") == 0 && i + 1 < argc) {
+            copies = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) {
+            ipf = strtoul(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            interval = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 10);
+        }
+        else if(strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        }
+        else if(strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            if(!parseQuirks(argv[++i], quirks)) {
+                usage();
+                return 1;
+            }
+        }
+        else if(argv[i][0] == '-') {
+            usage();
+            return 1;
+        }
+        else {
+            romFiles.push_back(argv[i]);
+            romQuirks.push_back(quirks);
+        }
+    }
+
+    if(romFiles.empty() || ipf == 0 || copies == 0) {
+        usage();
+        return 0;
+    }
+
+    //By default, every engine this build and host can run
+    bool jitAvailable = std::unique_ptr<Chip8Jit>(new Chip8Jit())->available();
+    if(engines.empty()) {
+        engines.push_back(VERIFY_CORE);
+        engines.push_back(VERIFY_INTERPRETER);
+        if(jitAvailable) {
+            engines.push_back(VERIFY_JIT);
+        }
+        if(Chip8Aot::linked() != NULL) {
+            engines.push_back(VERIFY_AOT);
+        }
+        engines.push_back(VERIFY_LOCKSTEP);
+    }
+    for(VerifyEngine engine : engines) {
+        if(engine == VERIFY_JIT && !jitAvailable) {
+            std::cout << "Error: JIT unavailable on this host\n";
+            return 1;
+        }
+        if(engine == VERIFY_AOT && Chip8Aot::linked() == NULL) {
+            std::cout << "Error: No ahead-of-time translation linked in\n";
+            return 1;
+        }
+    }
+
+    std::vector<std::vector<uint8_t>> roms(romFiles.size());
+    for(size_t r = 0; r < romFiles.size(); ++r) {
+        std::ifstream romStream(romFiles[r], std::ios::binary);
+        if(!romStream.is_open()) {
+            std::cout << "Error: Failed to open " << romFiles[r] << "\n";
+            return 1;
+        }
+        roms[r].assign(std::istreambuf_iterator<char>(romStream), {});
+    }
+
+    //Each engine runs every copy, with the same seeds and so the same key presses
+    std::vector<VerifyJob> jobs;
+    std::vector<size_t> jobRom;
+    for(size_t r = 0; r < roms.size(); ++r) {
+        for(uint32_t c = 0; c < copies; ++c) {
+            for(VerifyEngine engine : engines) {
+                VerifyJob job;
+                job.rom = &roms[r];
+                job.engine = engine;
+                job.seed = seed + c;
+                job.ipf = ipf;
+                job.frames = frames;
+                job.quirks = romQuirks[r];
+                jobs.push_back(job);
+                jobRom.push_back(r);
+            }
+        }
+    }
+
+    Chip8Verifier verifier(interval, threads);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<VerifyResult> results = verifier.run(jobs);
+    auto end = std::chrono::steady_clock::now();
+
+    static const char* outcomes[] = {"matched", "DIVERGED", "load-failed"};
+    uint64_t totalCycles = 0;
+    uint64_t totalChecks = 0;
+    uint64_t byOutcome[VERIFY_LOAD_FAILED + 1] = {0};
+    if(!quiet) {
+        printf("%-6s %-24s %-12s %-12s %-11s %-12s %-8s %s\n", "#", "rom", "engine", "seed", "result", "cycles", "checks", "state hash");
+    }
+    for(size_t i = 0; i < results.size(); ++i) {
+        const VerifyResult& result = results[i];
+        totalCycles += result.cycles;
+        totalChecks += result.checks;
+        ++byOutcome[result.outcome];
+        //Divergences are always listed
+        if(!quiet || result.outcome != VERIFY_MATCHED) {
+            printf("%-6zu %-24s %-12s %-12llu %-11s %-12llu %-8llu %016llx\n", i, romFiles[jobRom[i]].c_str(),
+                   verifyEngineName(jobs[i].engine), (unsigned long long)jobs[i].seed, outcomes[result.outcome],
+                   (unsigned long long)result.cycles, (unsigned long long)result.checks,
+                   (unsigned long long)result.stateHash);
+            Chip8Verifier::report(result);
+        }
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("Sessions:            %zu on %d workers\n", results.size(), verifier.workerCount());
+    printf("Results:             matched=%llu diverged=%llu load-failed=%llu\n", (unsigned long long)byOutcome[VERIFY_MATCHED],
+           (unsigned long long)byOutcome[VERIFY_DIVERGED], (unsigned long long)byOutcome[VERIFY_LOAD_FAILED]);
+    printf("Reference cycles:    %llu\n", (unsigned long long)totalCycles);
+    printf("State checks:        %llu\n", (unsigned long long)totalChecks);
+    printf("Wall time:           %.3f s\n", seconds);
+    return byOutcome[VERIFY_MATCHED] != results.size();
+}